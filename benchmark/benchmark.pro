@@ -0,0 +1,39 @@
+QT       += core gui widgets concurrent
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = FolderModelBenchmark
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += \
+    ../
+
+SOURCES += \
+    ../foldermodel.cpp \
+    ../folderscanner.cpp \
+    ../foldertreescanner.cpp \
+    ../foldersearcher.cpp \
+    ../foldericonloader.cpp \
+    ../foldersizecalculator.cpp \
+    ../folderstatloader.cpp \
+    ../folderentrytable.cpp \
+    ../folderlistingcache.cpp \
+    main.cpp
+
+HEADERS += \
+    ../foldermodel.h \
+    ../folderscanner.h \
+    ../foldertreescanner.h \
+    ../foldersearcher.h \
+    ../foldericonloader.h \
+    ../foldersizecalculator.h \
+    ../folderstatloader.h \
+    ../folderentrytable.h \
+    ../folderlistingcache.h
+
+linux {
+    SOURCES += ../linux.cpp
+    HEADERS += ../linux.h
+}
@@ -0,0 +1,538 @@
+﻿// FolderModel のベンチマーク
+//
+// usage : FolderModelBenchmark [--dir <path>] [--sizes <num,...>] [--case <name>] [--repeat <num>]
+//                              [--format text|json] [--output <file>]
+//
+// 既定では tmpfs(/dev/shm)上に 1,000 / 100,000 / 1,000,000 エントリのフォルダを作成し、
+// 列挙・読み込み・ソート・フィルタ・件数・パス検索・data() の各処理を計測する
+// --format json でリリース間の比較用に機械可読な結果を出力する
+//
+// システムコール数は --case で 1 ケースに絞り、strace -c -f で比較する
+//   ex. strace -c -f ./FolderModelBenchmark --sizes 1000000 --case enum-qdir
+//       strace -c -f ./FolderModelBenchmark --sizes 1000000 --case enum-native
+// FolderModel を使うので、GUI の無い環境では QT_QPA_PLATFORM=offscreen で実行する
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <functional>
+#include <algorithm>
+#include "folderentrytable.h"
+#include "foldermodel.h"
+#ifdef Q_OS_LINUX
+#include "linux.h"
+#endif
+
+using namespace Farman;
+
+namespace
+{
+
+const QStringList Suffixes = {"txt", "cpp", "h", "png", "jpg", "mp3", "zip", "pdf", ""};
+
+// 拡張子・サイズ・種別(フォルダ・隠しファイル)が混在するフォルダを作る
+int prepareFiles(const QString& path, int count)
+{
+    QDir dir(path);
+    if(!dir.exists() && !dir.mkpath("."))
+    {
+        return -1;
+    }
+
+    // 作成済みであれば作り直さない
+    if(dir.entryList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot).count() == count)
+    {
+        return 0;
+    }
+
+    for(int i = 0;i < count;i++)
+    {
+        QString name = QString("file%1").arg(i, 7, 10, QChar('0'));
+
+        if(i % 100 == 0)
+        {
+            if(!dir.exists(name) && !dir.mkdir(name))
+            {
+                return -1;
+            }
+
+            continue;
+        }
+
+        if(i % 50 == 0)
+        {
+            name.prepend('.');
+        }
+
+        const QString& suffix = Suffixes[i % Suffixes.count()];
+        if(!suffix.isEmpty())
+        {
+            name += "." + suffix;
+        }
+
+        QFile file(dir.filePath(name));
+        if(!file.exists())
+        {
+            if(!file.open(QIODevice::WriteOnly))
+            {
+                return -1;
+            }
+            file.resize((i * 7919) % 65536);
+        }
+    }
+
+    return 0;
+}
+
+// FolderModel の同期読み込み(QDir)と同じ手順
+int readByQDir(const QString& path)
+{
+    QDir dir(path);
+    dir.setFilter(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::AccessMask | QDir::NoDot);
+    dir.setNameFilters({"..", "*"});
+
+    FolderEntryTable entryTable;
+    entryTable.append(dir.entryInfoList());
+
+    return entryTable.count();
+}
+
+#ifdef Q_OS_LINUX
+int readByNative(const QString& path, int statFields)
+{
+    FolderEntryTable entryTable;
+    if(Linux::readFolderEntries(path, statFields, entryTable) < 0)
+    {
+        return -1;
+    }
+
+    return entryTable.count();
+}
+#endif
+
+QString sectionTypeName(SectionType sectionType)
+{
+    switch(sectionType)
+    {
+    case SectionType::FileName:     return "name";
+    case SectionType::FileType:     return "type";
+    case SectionType::FileSize:     return "size";
+    case SectionType::Owner:        return "owner";
+    case SectionType::Group:        return "group";
+    case SectionType::Permissions:  return "permissions";
+    case SectionType::Created:      return "created";
+    case SectionType::LastModified: return "modified";
+    default:                        return "none";
+    }
+}
+
+class Benchmark
+{
+public:
+    Benchmark(const QString& caseFilter, int repeat)
+        : m_caseFilter(caseFilter)
+        , m_repeat(repeat)
+        , m_results()
+    {
+    }
+
+    // func は処理したエントリ数(失敗時は -1)を返す
+    // setup は毎回 func の前に呼び、計測には含めない
+    void run(const QString& name, int entryNum, const std::function<int()>& func,
+             const std::function<void()>& setup = std::function<void()>())
+    {
+        if(!m_caseFilter.isEmpty() && !name.startsWith(m_caseFilter))
+        {
+            return;
+        }
+
+        QVector<qint64> times;
+        int processedNum = 0;
+
+        for(int i = 0;i < m_repeat;i++)
+        {
+            if(setup)
+            {
+                setup();
+            }
+
+            QElapsedTimer timer;
+            timer.start();
+
+            processedNum = func();
+
+            times.push_back(timer.nsecsElapsed());
+
+            if(processedNum < 0)
+            {
+                break;
+            }
+        }
+
+        std::sort(times.begin(), times.end());
+
+        QJsonObject result;
+        result["case"] = name;
+        result["entries"] = entryNum;
+        result["processed"] = processedNum;
+        result["runs"] = times.count();
+        result["min_us"] = times.first() / 1000;
+        result["median_us"] = times[times.count() / 2] / 1000;
+        result["max_us"] = times.last() / 1000;
+        result["ok"] = (processedNum >= 0);
+
+        m_results.push_back(result);
+    }
+
+    const QJsonArray& results() const
+    {
+        return m_results;
+    }
+
+private:
+    QString m_caseFilter;
+    int m_repeat;
+    QJsonArray m_results;
+};
+
+void runSuite(Benchmark& benchmark, const QString& path, int count)
+{
+    benchmark.run("enum-qdir", count, [&](){ return readByQDir(path); });
+#ifdef Q_OS_LINUX
+    // enum-native       : 既定の列(ファイル名・拡張子・サイズ・更新日時)に必要な属性のみ
+    // enum-native-all   : 全属性
+    // enum-native-nostat: 名前と d_type のみ(stat しない)
+    benchmark.run("enum-native", count, [&](){ return readByNative(path, FolderEntryTable::SizeField | FolderEntryTable::TimeField); });
+    benchmark.run("enum-native-all", count, [&](){ return readByNative(path, FolderEntryTable::AllStatFields); });
+    benchmark.run("enum-native-nostat", count, [&](){ return readByNative(path, FolderEntryTable::NoStatField); });
+#endif
+
+    FolderModel folderModel;
+    folderModel.setAutoUpdate(false);
+    folderModel.setFilterFlags(FilterFlag::AllEntrys | FilterFlag::Hidden | FilterFlag::System);
+
+    benchmark.run("setRootPath", count, [&]()
+    {
+        // 同じパスでも読み込み直す
+        return (folderModel.setRootPath(path) < 0) ? -1 : folderModel.rowCount();
+    });
+    benchmark.run("refresh", count, [&]()
+    {
+        return (folderModel.refresh() < 0) ? -1 : folderModel.rowCount();
+    });
+
+    // fetch-first : 要求分だけ列挙する場合に、最初のバッチを受け取るまで
+    folderModel.setIncrementalFetch(true);
+    benchmark.run("fetch-first", count, [&]()
+    {
+        folderModel.refresh();
+        while(folderModel.rowCount() == 0 && folderModel.isLoading())
+        {
+            QCoreApplication::processEvents();
+        }
+        return folderModel.rowCount();
+    });
+    folderModel.setIncrementalFetch(false);
+
+    // refresh-lazy-stat : 名前と種別のみ列挙する場合(表示する行の属性はバックグラウンドで取得する)
+    folderModel.setLazyStat(true);
+    benchmark.run("refresh-lazy-stat", count, [&]()
+    {
+        return (folderModel.refresh() < 0) ? -1 : folderModel.rowCount();
+    });
+    folderModel.setLazyStat(false);
+
+    // sort-* : 読み込み + ソート
+    folderModel.setParallelSortThreshold(0);
+    benchmark.run("sort-sequential", count, [&]()
+    {
+        folderModel.setParallelSort(false);
+        return (folderModel.refresh() < 0) ? -1 : folderModel.rowCount();
+    });
+    benchmark.run("sort-parallel", count, [&]()
+    {
+        folderModel.setParallelSort(true);
+        return (folderModel.refresh() < 0) ? -1 : folderModel.rowCount();
+    });
+
+    // sort-visible-first : 先頭の表示範囲のみ並べて表示するまで(残りのバックグラウンドのソートは計測しない)
+    folderModel.setVisibleFirstSort(true);
+    folderModel.setVisibleFirstSortThreshold(0);
+    benchmark.run("sort-visible-first", count, [&]()
+    {
+        return (folderModel.refresh() < 0) ? -1 : folderModel.rowCount();
+    }, [&]()
+    {
+        while(folderModel.isSorting())
+        {
+            QCoreApplication::processEvents();
+        }
+    });
+    folderModel.setVisibleFirstSort(false);
+
+    // sort-order-check : 並列ソートの結果が逐次ソートと一致することを確認する(一致しなければ失敗)
+    benchmark.run("sort-order-check", count, [&]()
+    {
+        QStringList fileNames[2];
+        for(int parallel = 0;parallel < 2;parallel++)
+        {
+            folderModel.setParallelSort(parallel != 0);
+            folderModel.refresh();
+            for(int row = 0;row < folderModel.rowCount();row++)
+            {
+                fileNames[parallel].push_back(folderModel.fileName(folderModel.index(row, 0)));
+            }
+        }
+        return (fileNames[0] == fileNames[1]) ? fileNames[0].count() : -1;
+    });
+    folderModel.setParallelSort(true);
+    folderModel.setParallelSortThreshold(100000);
+
+    // resort-<1st>[-<2nd>] : 並び替えのみ(毎回昇順・降順を切り替えて並びを変える)
+    const QList<SectionType> sectionTypes = {SectionType::FileName, SectionType::FileType, SectionType::FileSize,
+                                             SectionType::Owner, SectionType::Group, SectionType::Permissions,
+                                             SectionType::Created, SectionType::LastModified};
+    foreach(SectionType sectionType, sectionTypes)
+    {
+        foreach(SectionType sectionType2nd, QList<SectionType>({SectionType::Unknown, SectionType::FileName, SectionType::FileType}))
+        {
+            if(sectionType2nd == sectionType)
+            {
+                continue;
+            }
+
+            QString name = "resort-" + sectionTypeName(sectionType);
+            if(sectionType2nd != SectionType::Unknown)
+            {
+                name += "-" + sectionTypeName(sectionType2nd);
+            }
+
+            folderModel.setSortSectionType(sectionType);
+            folderModel.setSortSectionType2nd(sectionType2nd);
+
+            benchmark.run(name, count, [&]()
+            {
+                folderModel.setSortOrder((folderModel.sortOrder() == SortOrderType::Ascending) ? SortOrderType::Descending : SortOrderType::Ascending);
+                folderModel.resort();
+                return folderModel.rowCount();
+            });
+        }
+    }
+    // resort-4keys : キーを 4 つ指定した場合(キーごとに昇順・降順を変える)
+    folderModel.setSortKeys({{SectionType::FileType, SortOrderType::Ascending},
+                             {SectionType::FileSize, SortOrderType::Descending},
+                             {SectionType::LastModified, SortOrderType::Ascending},
+                             {SectionType::FileName, SortOrderType::Descending}});
+    benchmark.run("resort-4keys", count, [&]()
+    {
+        QList<SortKey> sortKeys = folderModel.sortKeys();
+        for(int i = 0;i < sortKeys.count();i++)
+        {
+            sortKeys[i].order = (sortKeys[i].order == SortOrderType::Ascending) ? SortOrderType::Descending : SortOrderType::Ascending;
+        }
+        folderModel.setSortKeys(sortKeys);
+        folderModel.resort();
+        return folderModel.rowCount();
+    });
+
+    folderModel.setSortKeys({{SectionType::FileName, SortOrderType::Ascending}});
+
+    // resort-natural : 数字を数値として比較、resort-locale : ロケールの照合順序(比較キーは初回のみ作る)
+    folderModel.setSortNaturalOrder(true);
+    benchmark.run("resort-natural", count, [&]()
+    {
+        folderModel.setSortOrder((folderModel.sortOrder() == SortOrderType::Ascending) ? SortOrderType::Descending : SortOrderType::Ascending);
+        folderModel.resort();
+        return folderModel.rowCount();
+    });
+    folderModel.setSortLocaleAware(true);
+    benchmark.run("resort-locale", count, [&]()
+    {
+        folderModel.setSortOrder((folderModel.sortOrder() == SortOrderType::Ascending) ? SortOrderType::Descending : SortOrderType::Ascending);
+        folderModel.resort();
+        return folderModel.rowCount();
+    });
+    folderModel.setSortNaturalOrder(false);
+    folderModel.setSortLocaleAware(false);
+
+    folderModel.setSortOrder(SortOrderType::Ascending);
+    folderModel.resort();
+
+    // filter-apply : 絞り込み、filter-clear : 絞り込みの解除
+    benchmark.run("filter-apply", count, [&]()
+    {
+        folderModel.setNameFilters({"*.txt", "*.cpp"});
+        folderModel.refilter();
+        return folderModel.rowCount();
+    }, [&]()
+    {
+        folderModel.setNameFilters({"*"});
+        folderModel.refilter();
+    });
+    benchmark.run("filter-clear", count, [&]()
+    {
+        folderModel.setNameFilters({"*"});
+        folderModel.refilter();
+        return folderModel.rowCount();
+    }, [&]()
+    {
+        folderModel.setNameFilters({"*.txt", "*.cpp"});
+        folderModel.refilter();
+    });
+
+    benchmark.run("counts", count, [&]()
+    {
+        return folderModel.fileNum() + folderModel.dirNum() + folderModel.fileDirNum();
+    });
+
+    // index-path : 1,000 件のパスから行を引く
+    QStringList paths;
+    for(int i = 0;i < 1000;i++)
+    {
+        paths.push_back(folderModel.filePath(folderModel.index(static_cast<int>(static_cast<qint64>(folderModel.rowCount()) * i / 1000), 0)));
+    }
+    benchmark.run("index-path", paths.count(), [&]()
+    {
+        int found = 0;
+        foreach(const QString& filePath, paths)
+        {
+            if(folderModel.index(filePath).isValid())
+            {
+                found++;
+            }
+        }
+        return found;
+    });
+
+    // data-page : 1 画面分(40 行)の全ての列・ロールを、フォルダ内の 25 箇所で取得する
+    //             1 回目は表示文字列・アイコンのキャッシュが無い状態になる
+    const QList<int> roles =
+    {
+        Qt::DisplayRole, Qt::EditRole, Qt::DecorationRole, Qt::FontRole, Qt::TextAlignmentRole,
+        Qt::TextColorRole, Qt::BackgroundRole,
+        Qt::UserRole + 1, Qt::UserRole + 2, Qt::UserRole + 3,           // FilePathRole, FileNameRole, FilePermissions
+    };
+    benchmark.run("data-page", count, [&]()
+    {
+        int cellNum = 0;
+        for(int page = 0;page < 25;page++)
+        {
+            int firstRow = static_cast<int>(static_cast<qint64>(folderModel.rowCount()) * page / 25);
+            int lastRow = qMin(firstRow + 40, folderModel.rowCount());
+            for(int row = firstRow;row < lastRow;row++)
+            {
+                for(int column = 0;column < folderModel.columnCount();column++)
+                {
+                    QModelIndex index = folderModel.index(row, column);
+                    foreach(int role, roles)
+                    {
+                        folderModel.data(index, role);
+                    }
+                    cellNum++;
+                }
+            }
+        }
+        return cellNum;
+    });
+}
+
+}           // namespace
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("dir", "Base directory for the generated folders.", "path", "/dev/shm/foldermodel-benchmark"));
+    parser.addOption(QCommandLineOption("sizes", "Comma separated entry counts.", "nums", "1000,100000,1000000"));
+    parser.addOption(QCommandLineOption("case", "Run only the cases starting with this name.", "name"));
+    parser.addOption(QCommandLineOption("repeat", "Number of runs per case.", "num", "5"));
+    parser.addOption(QCommandLineOption("format", "Output format (text or json).", "format", "text"));
+    parser.addOption(QCommandLineOption("output", "Write the results to a file instead of stdout.", "file"));
+    parser.process(app);
+
+    QString basePath = parser.value("dir");
+    QString caseName = parser.value("case");
+    int repeat = qMax(parser.value("repeat").toInt(), 1);
+    bool json = (parser.value("format") == "json");
+
+    QTextStream err(stderr);
+    Benchmark benchmark(caseName, repeat);
+
+    foreach(const QString& size, parser.value("sizes").split(','))
+    {
+        int count = size.toInt();
+        if(count <= 0)
+        {
+            continue;
+        }
+
+        QString path = QDir(basePath).filePath(QString::number(count));
+
+        err << "preparing " << path << "\n";
+        err.flush();
+
+        if(prepareFiles(path, count) < 0)
+        {
+            err << "failed to prepare " << path << "\n";
+
+            return 1;
+        }
+
+        runSuite(benchmark, path, count);
+    }
+
+    QFile outputFile;
+    if(parser.isSet("output"))
+    {
+        outputFile.setFileName(parser.value("output"));
+        if(!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            err << "failed to open " << outputFile.fileName() << "\n";
+
+            return 1;
+        }
+    }
+    else
+    {
+        outputFile.open(stdout, QIODevice::WriteOnly);
+    }
+
+    QTextStream out(&outputFile);
+
+    if(json)
+    {
+        QJsonObject root;
+        root["qt"] = QString(qVersion());
+        root["repeat"] = repeat;
+        root["results"] = benchmark.results();
+
+        out << QJsonDocument(root).toJson(QJsonDocument::Indented);
+    }
+    else
+    {
+        foreach(const QJsonValue& value, benchmark.results())
+        {
+            const QJsonObject result = value.toObject();
+
+            out << QString("%1 %2 : min %3 us, median %4 us (%5)%6\n")
+                   .arg(result["entries"].toInt(), 8)
+                   .arg(result["case"].toString(), -24)
+                   .arg(result["min_us"].toVariant().toLongLong())
+                   .arg(result["median_us"].toVariant().toLongLong())
+                   .arg(result["processed"].toInt())
+                   .arg(result["ok"].toBool() ? "" : " FAILED");
+        }
+    }
+
+    out.flush();
+
+    return 0;
+}
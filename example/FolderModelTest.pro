@@ -1,6 +1,6 @@
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 CONFIG += c++11
 
@@ -20,13 +20,34 @@ INCLUDEPATH += \
 
 SOURCES += \
     ../foldermodel.cpp \
+    ../folderscanner.cpp \
+    ../foldertreescanner.cpp \
+    ../foldersearcher.cpp \
+    ../foldericonloader.cpp \
+    ../foldersizecalculator.cpp \
+    ../folderstatloader.cpp \
+    ../folderentrytable.cpp \
+    ../folderlistingcache.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
     ../foldermodel.h \
+    ../folderscanner.h \
+    ../foldertreescanner.h \
+    ../foldersearcher.h \
+    ../foldericonloader.h \
+    ../foldersizecalculator.h \
+    ../folderstatloader.h \
+    ../folderentrytable.h \
+    ../folderlistingcache.h \
     mainwindow.h
 
+linux {
+    SOURCES += ../linux.cpp
+    HEADERS += ../linux.h
+}
+
 FORMS += \
     mainwindow.ui
 
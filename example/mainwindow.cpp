@@ -113,7 +113,7 @@ void MainWindow::on_hiddenFilterCheckBox_clicked(bool checked)
 
     m_folderModel->setFilterFlags(filterFlag);
 
-    m_folderModel->refresh();
+    m_folderModel->refilter();
 }
 
 void MainWindow::on_systemFilterCheckBox_clicked(bool checked)
@@ -130,7 +130,7 @@ void MainWindow::on_systemFilterCheckBox_clicked(bool checked)
 
     m_folderModel->setFilterFlags(filterFlag);
 
-    m_folderModel->refresh();
+    m_folderModel->refilter();
 }
 
 void MainWindow::on_filesFilterCheckBox_clicked(bool checked)
@@ -147,7 +147,7 @@ void MainWindow::on_filesFilterCheckBox_clicked(bool checked)
 
     m_folderModel->setFilterFlags(filterFlag);
 
-    m_folderModel->refresh();
+    m_folderModel->refilter();
 }
 
 void MainWindow::on_dirsFilterCheckBox_clicked(bool checked)
@@ -164,7 +164,7 @@ void MainWindow::on_dirsFilterCheckBox_clicked(bool checked)
 
     m_folderModel->setFilterFlags(filterFlag);
 
-    m_folderModel->refresh();
+    m_folderModel->refilter();
 }
 
 void MainWindow::on_nameMaskFilterLineEdit_textEdited(const QString &arg1)
@@ -174,7 +174,7 @@ void MainWindow::on_nameMaskFilterLineEdit_textEdited(const QString &arg1)
     QStringList nameFilters = ui->nameMaskFilterLineEdit->text().split(' ');
     m_folderModel->setNameFilters(nameFilters);
 
-    m_folderModel->refresh();
+    m_folderModel->refilter();
 }
 
 void MainWindow::on_nameSortRadioButton_clicked()
@@ -192,7 +192,7 @@ void MainWindow::on_nameSortRadioButton_clicked()
     ui->sizeSort2ndRadioButton->setEnabled(true);
     ui->lastModifiedSort2ndRadioButton->setEnabled(true);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_extSortRadioButton_clicked()
@@ -210,7 +210,7 @@ void MainWindow::on_extSortRadioButton_clicked()
     ui->sizeSort2ndRadioButton->setEnabled(true);
     ui->lastModifiedSort2ndRadioButton->setEnabled(true);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_sizeSortRadioButton_clicked()
@@ -228,7 +228,7 @@ void MainWindow::on_sizeSortRadioButton_clicked()
     ui->sizeSort2ndRadioButton->setEnabled(false);
     ui->lastModifiedSort2ndRadioButton->setEnabled(true);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_lastModifiedSortRadioButton_clicked()
@@ -246,91 +246,91 @@ void MainWindow::on_lastModifiedSortRadioButton_clicked()
     ui->sizeSort2ndRadioButton->setEnabled(true);
     ui->lastModifiedSort2ndRadioButton->setEnabled(false);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_nameSort2ndRadioButton_clicked()
 {
     m_folderModel->setSortSectionType2nd(SectionType::FileName);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_extSort2ndRadioButton_clicked()
 {
     m_folderModel->setSortSectionType2nd(SectionType::FileType);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_sizeSort2ndRadioButton_clicked()
 {
     m_folderModel->setSortSectionType2nd(SectionType::FileSize);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_lastModifiedSort2ndRadioButton_clicked()
 {
     m_folderModel->setSortSectionType2nd(SectionType::LastModified);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_noneSort2ndRadioButton_clicked()
 {
     m_folderModel->setSortSectionType2nd(SectionType::Unknown);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_firstFoldersRadioButton_clicked()
 {
     m_folderModel->setSortDirsType(SortDirsType::First);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_lastFoldersRadioButton_clicked()
 {
     m_folderModel->setSortDirsType(SortDirsType::Last);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_NoSpecifyRadioButton_clicked()
 {
     m_folderModel->setSortDirsType(SortDirsType::NoSpecify);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_ascendingRadioButton_clicked()
 {
     m_folderModel->setSortOrder(SortOrderType::Ascending);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_decendingRadioButton_clicked()
 {
     m_folderModel->setSortOrder(SortOrderType::Descending);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_sensitiveRadioButton_clicked()
 {
     m_folderModel->setSortCaseSensitivity(SortCaseSensitivity::Sensitive);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_InsensitiveRadioButton_clicked()
 {
     m_folderModel->setSortCaseSensitivity(SortCaseSensitivity::Insensitive);
 
-    m_folderModel->refresh();
+    m_folderModel->resort();
 }
 
 void MainWindow::on_formatFileSizeSIRadioButton_clicked()
@@ -338,8 +338,6 @@ void MainWindow::on_formatFileSizeSIRadioButton_clicked()
     ui->formatFileSizeCommaCheckBox->setEnabled(false);
 
     m_folderModel->setFileSizeFormatType(FileSizeFormatType::SI);
-
-    m_folderModel->refresh();
 }
 
 void MainWindow::on_formatFileSizeIecRadioButton_clicked()
@@ -347,8 +345,6 @@ void MainWindow::on_formatFileSizeIecRadioButton_clicked()
     ui->formatFileSizeCommaCheckBox->setEnabled(false);
 
     m_folderModel->setFileSizeFormatType(FileSizeFormatType::IEC);
-
-    m_folderModel->refresh();
 }
 
 void MainWindow::on_formatFileSizeDetailRadioButton_clicked()
@@ -356,15 +352,11 @@ void MainWindow::on_formatFileSizeDetailRadioButton_clicked()
     ui->formatFileSizeCommaCheckBox->setEnabled(true);
 
     m_folderModel->setFileSizeFormatType(FileSizeFormatType::Detail);
-
-    m_folderModel->refresh();
 }
 
 void MainWindow::on_formatFileSizeCommaCheckBox_clicked(bool checked)
 {
     m_folderModel->setFileSizeComma(checked);
-
-    m_folderModel->refresh();
 }
 
 void MainWindow::on_formatDateDefaultRadioButton_clicked()
@@ -372,8 +364,6 @@ void MainWindow::on_formatDateDefaultRadioButton_clicked()
     ui->formatDateOriginalLineEdit->setEnabled(false);
 
     m_folderModel->setDateFormatType(DateFormatType::Default);
-
-    m_folderModel->refresh();
 }
 
 void MainWindow::on_formatDateISORadioButton_clicked()
@@ -381,8 +371,6 @@ void MainWindow::on_formatDateISORadioButton_clicked()
     ui->formatDateOriginalLineEdit->setEnabled(false);
 
     m_folderModel->setDateFormatType(DateFormatType::ISO);
-
-    m_folderModel->refresh();
 }
 
 void MainWindow::on_formatDateOriginalRadioButton_clicked()
@@ -390,13 +378,9 @@ void MainWindow::on_formatDateOriginalRadioButton_clicked()
     ui->formatDateOriginalLineEdit->setEnabled(true);
 
     m_folderModel->setDateFormatType(DateFormatType::Original);
-
-    m_folderModel->refresh();
 }
 
 void MainWindow::on_formatDateOriginalLineEdit_textEdited(const QString &arg1)
 {
     m_folderModel->setDateFormatOriginalString(arg1);
-
-    m_folderModel->refresh();
 }
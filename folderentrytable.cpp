@@ -0,0 +1,553 @@
+﻿#include <QDateTime>
+#include <cstring>
+#include "folderentrytable.h"
+#ifdef Q_OS_WIN
+#include "win32.h"
+#endif
+
+namespace Farman
+{
+
+namespace
+{
+
+const quint32 SerializedMagic = 0x42544546;         // "FETB"
+const quint32 SerializedVersion = 2;                // 2 : 時刻を msec 精度に揃えた
+
+struct SerializedHeader
+{
+    quint32 magic;
+    quint32 version;
+    qint32 count;
+    qint32 statFields;
+    qint32 nameArenaSize;
+    qint32 foldedNameArenaSize;
+};
+
+// 無効な時刻(ファイルシステムが作成日時を持たない場合など)は 0 にする
+qint64 dateTimeToNsecs(const QDateTime& time)
+{
+    return (time.isValid()) ? time.toMSecsSinceEpoch() * 1000000 : 0;
+}
+
+template<typename T>
+void appendColumn(QByteArray& data, const T* values, int count)
+{
+    data.append(reinterpret_cast<const char*>(values), static_cast<int>(count * sizeof(T)));
+    data.append(QByteArray((8 - data.size() % 8) % 8, '\0'));
+}
+
+// 残りのバイト数が T の count 個分あるか(確保する前に確認する)
+template<typename T>
+bool hasColumn(const char* data, const char* end, int count)
+{
+    return count >= 0 && static_cast<qint64>(count) * static_cast<qint64>(sizeof(T)) <= end - data;
+}
+
+template<typename T>
+bool readColumn(const char** data, const char* end, T* values, int count)
+{
+    if(!hasColumn<T>(*data, end, count))
+    {
+        return false;
+    }
+
+    qint64 size = static_cast<qint64>(count) * sizeof(T);
+
+    std::memcpy(values, *data, static_cast<size_t>(size));
+    *data += qMin<qint64>((size + 7) / 8 * 8, end - *data);
+
+    return true;
+}
+
+template<typename T>
+bool readColumn(const char** data, const char* end, QVector<T>& values, int count)
+{
+    if(!hasColumn<T>(*data, end, count))
+    {
+        return false;
+    }
+
+    values.resize(count);
+
+    return readColumn(data, end, values.data(), count);
+}
+
+}           // namespace
+
+FolderEntryTable::FolderEntryTable()
+    : m_nameArena()
+    , m_nameOffsets()
+    , m_nameLengths()
+    , m_baseNameLengths()
+    , m_foldedNameArena()
+    , m_foldedNameOffsets()
+    , m_foldedNameLengths()
+    , m_foldedBaseNameLengths()
+    , m_typeFlags()
+    , m_sizes()
+    , m_lastModifieds()
+    , m_createds()
+    , m_permissions()
+    , m_ownerIds()
+    , m_groupIds()
+    , m_statFields(AllStatFields)
+    , m_nameIndex()
+    , m_indexedCount(0)
+{
+}
+
+int FolderEntryTable::count() const
+{
+    return m_typeFlags.count();
+}
+
+bool FolderEntryTable::isEmpty() const
+{
+    return m_typeFlags.isEmpty();
+}
+
+void FolderEntryTable::reserve(int size)
+{
+    m_nameOffsets.reserve(size);
+    m_nameLengths.reserve(size);
+    m_baseNameLengths.reserve(size);
+    m_foldedNameOffsets.reserve(size);
+    m_foldedNameLengths.reserve(size);
+    m_foldedBaseNameLengths.reserve(size);
+    m_typeFlags.reserve(size);
+    m_sizes.reserve(size);
+    m_lastModifieds.reserve(size);
+    m_createds.reserve(size);
+    m_permissions.reserve(size);
+    m_ownerIds.reserve(size);
+    m_groupIds.reserve(size);
+}
+
+void FolderEntryTable::clear()
+{
+    *this = FolderEntryTable();
+}
+
+void FolderEntryTable::setStatFields(int statFields)
+{
+    m_statFields = statFields;
+}
+
+int FolderEntryTable::statFields() const
+{
+    return m_statFields;
+}
+
+int FolderEntryTable::append(const QFileInfo& fileInfo)
+{
+    QString fileName = fileInfo.fileName();
+
+    int typeFlags = 0;
+    if(fileInfo.isDir())
+    {
+        typeFlags |= Dir;
+    }
+    else if(fileInfo.isFile())
+    {
+        typeFlags |= File;
+    }
+    if(fileInfo.isSymLink())
+    {
+        typeFlags |= SymLink;
+    }
+    if(fileName == "..")
+    {
+        typeFlags |= DotDot;
+    }
+    else
+    {
+        if(fileInfo.isHidden())
+        {
+            typeFlags |= Hidden;
+        }
+#ifdef Q_OS_WIN
+        if(Win32::isSystemFile(fileInfo.absoluteFilePath()))
+        {
+            typeFlags |= System;
+        }
+#endif
+    }
+    if(fileInfo.isWritable())
+    {
+        typeFlags |= Writable;
+    }
+
+    return append(fileName,
+                  typeFlags,
+                  fileInfo.size(),
+                  dateTimeToNsecs(fileInfo.lastModified()),
+                  dateTimeToNsecs(fileInfo.birthTime()),
+                  fileInfo.permissions(),
+                  fileInfo.ownerId(),
+                  fileInfo.groupId());
+}
+
+int FolderEntryTable::append(const QString& fileName, int typeFlags, qint64 size, qint64 lastModified, qint64 created,
+                             QFile::Permissions permissions, uint ownerId, uint groupId)
+{
+    appendName(fileName, m_nameArena, m_nameOffsets, m_nameLengths, m_baseNameLengths);
+    appendName(fileName.toLower(), m_foldedNameArena, m_foldedNameOffsets, m_foldedNameLengths, m_foldedBaseNameLengths);
+
+    m_typeFlags.push_back(static_cast<quint8>(typeFlags));
+    m_sizes.push_back(size);
+    m_lastModifieds.push_back(lastModified);
+    m_createds.push_back(created);
+    m_permissions.push_back(static_cast<quint16>(permissions));
+    m_ownerIds.push_back(ownerId);
+    m_groupIds.push_back(groupId);
+
+    return count() - 1;
+}
+
+void FolderEntryTable::append(const QFileInfoList& fileInfoList)
+{
+    reserve(count() + fileInfoList.count());
+    foreach(const QFileInfo& fileInfo, fileInfoList)
+    {
+        append(fileInfo);
+    }
+}
+
+void FolderEntryTable::append(const FolderEntryTable& other)
+{
+    if(isEmpty())
+    {
+        *this = other;
+
+        return;
+    }
+
+    // どちらかで取得していない属性は、結合後も取得していない扱いにする
+    m_statFields &= other.m_statFields;
+
+    int nameArenaSize = m_nameArena.size();
+    int foldedNameArenaSize = m_foldedNameArena.size();
+
+    m_nameArena += other.m_nameArena;
+    m_foldedNameArena += other.m_foldedNameArena;
+
+    for(int index = 0;index < other.count();index++)
+    {
+        m_nameOffsets.push_back(other.m_nameOffsets[index] + nameArenaSize);
+        m_foldedNameOffsets.push_back(other.m_foldedNameOffsets[index] + foldedNameArenaSize);
+    }
+
+    m_nameLengths += other.m_nameLengths;
+    m_baseNameLengths += other.m_baseNameLengths;
+    m_foldedNameLengths += other.m_foldedNameLengths;
+    m_foldedBaseNameLengths += other.m_foldedBaseNameLengths;
+    m_typeFlags += other.m_typeFlags;
+    m_sizes += other.m_sizes;
+    m_lastModifieds += other.m_lastModifieds;
+    m_createds += other.m_createds;
+    m_permissions += other.m_permissions;
+    m_ownerIds += other.m_ownerIds;
+    m_groupIds += other.m_groupIds;
+}
+
+void FolderEntryTable::appendName(const QString& name, QString& arena, QVector<int>& offsets,
+                                  QVector<quint16>& lengths, QVector<quint16>& baseNameLengths)
+{
+    int lastDot = name.lastIndexOf('.');
+
+    // 相対パスの場合は、ディレクトリ部分とファイル名先頭の '.' を拡張子の区切りとして扱わない
+    int lastSlash = name.lastIndexOf('/');
+    if(lastSlash >= 0 && lastDot <= lastSlash + 1)
+    {
+        lastDot = -1;
+    }
+
+    offsets.push_back(arena.size());
+    lengths.push_back(static_cast<quint16>(name.size()));
+    baseNameLengths.push_back(static_cast<quint16>((lastDot >= 0) ? lastDot : name.size()));
+
+    arena += name;
+}
+
+bool FolderEntryTable::isAttributeChanged(int index, const FolderEntryTable& other, int otherIndex) const
+{
+    // 新たに取得した属性は、取得していなかった値(0)から変わったものとする
+    if(other.m_statFields & ~m_statFields)
+    {
+        return true;
+    }
+
+    // other で取得していない属性は比較しない
+    int statFields = m_statFields & other.m_statFields;
+    int typeFlagsMask = (statFields & ModeField) ? ~0 : ~static_cast<int>(Writable);
+
+    return ((m_typeFlags[index] ^ other.m_typeFlags[otherIndex]) & typeFlagsMask) ||
+           ((statFields & SizeField) && m_sizes[index] != other.m_sizes[otherIndex]) ||
+           ((statFields & TimeField) && (m_lastModifieds[index] != other.m_lastModifieds[otherIndex] ||
+                                         m_createds[index] != other.m_createds[otherIndex])) ||
+           ((statFields & ModeField) && m_permissions[index] != other.m_permissions[otherIndex]) ||
+           ((statFields & OwnerField) && (m_ownerIds[index] != other.m_ownerIds[otherIndex] ||
+                                          m_groupIds[index] != other.m_groupIds[otherIndex]));
+}
+
+void FolderEntryTable::setAttributes(int index, const FolderEntryTable& other, int otherIndex, int statFields)
+{
+    if(statFields & SizeField)
+    {
+        m_sizes[index] = other.m_sizes[otherIndex];
+    }
+    if(statFields & TimeField)
+    {
+        m_lastModifieds[index] = other.m_lastModifieds[otherIndex];
+        m_createds[index] = other.m_createds[otherIndex];
+    }
+    if(statFields & ModeField)
+    {
+        m_permissions[index] = other.m_permissions[otherIndex];
+        m_typeFlags[index] = static_cast<quint8>((m_typeFlags[index] & ~Writable) | (other.m_typeFlags[otherIndex] & Writable));
+    }
+    if(statFields & OwnerField)
+    {
+        m_ownerIds[index] = other.m_ownerIds[otherIndex];
+        m_groupIds[index] = other.m_groupIds[otherIndex];
+    }
+}
+
+QByteArray FolderEntryTable::serialize() const
+{
+    SerializedHeader header;
+    header.magic = SerializedMagic;
+    header.version = SerializedVersion;
+    header.count = count();
+    header.statFields = m_statFields;
+    header.nameArenaSize = m_nameArena.size();
+    header.foldedNameArenaSize = m_foldedNameArena.size();
+
+    QByteArray data;
+    appendColumn(data, &header, 1);
+    appendColumn(data, m_nameArena.constData(), m_nameArena.size());
+    appendColumn(data, m_nameOffsets.constData(), count());
+    appendColumn(data, m_nameLengths.constData(), count());
+    appendColumn(data, m_baseNameLengths.constData(), count());
+    appendColumn(data, m_foldedNameArena.constData(), m_foldedNameArena.size());
+    appendColumn(data, m_foldedNameOffsets.constData(), count());
+    appendColumn(data, m_foldedNameLengths.constData(), count());
+    appendColumn(data, m_foldedBaseNameLengths.constData(), count());
+    appendColumn(data, m_typeFlags.constData(), count());
+    appendColumn(data, m_sizes.constData(), count());
+    appendColumn(data, m_lastModifieds.constData(), count());
+    appendColumn(data, m_createds.constData(), count());
+    appendColumn(data, m_permissions.constData(), count());
+    appendColumn(data, m_ownerIds.constData(), count());
+    appendColumn(data, m_groupIds.constData(), count());
+
+    return data;
+}
+
+bool FolderEntryTable::deserialize(const char* data, qint64 size)
+{
+    const char* end = data + size;
+
+    SerializedHeader header;
+    if(!readColumn(&data, end, &header, 1) ||
+       header.magic != SerializedMagic || header.version != SerializedVersion ||
+       header.count < 0 || header.nameArenaSize < 0 || header.foldedNameArenaSize < 0)
+    {
+        return false;
+    }
+
+    FolderEntryTable table;
+    table.m_statFields = header.statFields;
+
+    // ヘッダの件数を信用して確保しないように、各列は残りのバイト数を確認してから確保する
+    int count = header.count;
+    if(!hasColumn<QChar>(data, end, header.nameArenaSize))
+    {
+        return false;
+    }
+    table.m_nameArena.resize(header.nameArenaSize);
+    if(!readColumn(&data, end, table.m_nameArena.data(), header.nameArenaSize) ||
+       !readColumn(&data, end, table.m_nameOffsets, count) ||
+       !readColumn(&data, end, table.m_nameLengths, count) ||
+       !readColumn(&data, end, table.m_baseNameLengths, count) ||
+       !hasColumn<QChar>(data, end, header.foldedNameArenaSize))
+    {
+        return false;
+    }
+    table.m_foldedNameArena.resize(header.foldedNameArenaSize);
+    if(!readColumn(&data, end, table.m_foldedNameArena.data(), header.foldedNameArenaSize) ||
+       !readColumn(&data, end, table.m_foldedNameOffsets, count) ||
+       !readColumn(&data, end, table.m_foldedNameLengths, count) ||
+       !readColumn(&data, end, table.m_foldedBaseNameLengths, count) ||
+       !readColumn(&data, end, table.m_typeFlags, count) ||
+       !readColumn(&data, end, table.m_sizes, count) ||
+       !readColumn(&data, end, table.m_lastModifieds, count) ||
+       !readColumn(&data, end, table.m_createds, count) ||
+       !readColumn(&data, end, table.m_permissions, count) ||
+       !readColumn(&data, end, table.m_ownerIds, count) ||
+       !readColumn(&data, end, table.m_groupIds, count))
+    {
+        return false;
+    }
+
+    // 壊れたファイルで範囲外を参照しないように確認しておく
+    for(int index = 0;index < count;index++)
+    {
+        if(table.m_nameOffsets[index] < 0 ||
+           static_cast<qint64>(table.m_nameOffsets[index]) + table.m_nameLengths[index] > header.nameArenaSize ||
+           table.m_foldedNameOffsets[index] < 0 ||
+           static_cast<qint64>(table.m_foldedNameOffsets[index]) + table.m_foldedNameLengths[index] > header.foldedNameArenaSize ||
+           table.m_baseNameLengths[index] > table.m_nameLengths[index] ||
+           table.m_foldedBaseNameLengths[index] > table.m_foldedNameLengths[index])
+        {
+            return false;
+        }
+    }
+
+    *this = table;
+
+    return true;
+}
+
+int FolderEntryTable::indexOf(const QString& fileName) const
+{
+    // エントリは追加のみなので、前回から増えた分だけ登録する
+    if(m_indexedCount < count())
+    {
+        m_nameIndex.reserve(count());
+        for(int index = m_indexedCount;index < count();index++)
+        {
+            m_nameIndex.insert(this->fileName(index), index);
+        }
+        m_indexedCount = count();
+    }
+
+    return m_nameIndex.value(fileName, -1);
+}
+
+QString FolderEntryTable::fileName(int index) const
+{
+    return QString(m_nameArena.constData() + m_nameOffsets[index], m_nameLengths[index]);
+}
+
+QString FolderEntryTable::completeBaseName(int index) const
+{
+    return QString(m_nameArena.constData() + m_nameOffsets[index], m_baseNameLengths[index]);
+}
+
+QString FolderEntryTable::suffix(int index) const
+{
+    int baseNameLength = m_baseNameLengths[index];
+    int length = m_nameLengths[index];
+
+    if(baseNameLength >= length)
+    {
+        return QString();
+    }
+
+    return QString(m_nameArena.constData() + m_nameOffsets[index] + baseNameLength + 1, length - baseNameLength - 1);
+}
+
+const QChar* FolderEntryTable::nameData(int index, bool folded) const
+{
+    return (folded) ? m_foldedNameArena.constData() + m_foldedNameOffsets[index] :
+                      m_nameArena.constData() + m_nameOffsets[index];
+}
+
+int FolderEntryTable::nameLength(int index, bool folded) const
+{
+    return (folded) ? m_foldedNameLengths[index] : m_nameLengths[index];
+}
+
+int FolderEntryTable::baseNameLength(int index, bool folded) const
+{
+    return (folded) ? m_foldedBaseNameLengths[index] : m_baseNameLengths[index];
+}
+
+int FolderEntryTable::typeFlags(int index) const
+{
+    return m_typeFlags[index];
+}
+
+bool FolderEntryTable::isDir(int index) const
+{
+    return m_typeFlags[index] & Dir;
+}
+
+bool FolderEntryTable::isFile(int index) const
+{
+    return m_typeFlags[index] & File;
+}
+
+bool FolderEntryTable::isSymLink(int index) const
+{
+    return m_typeFlags[index] & SymLink;
+}
+
+bool FolderEntryTable::isHidden(int index) const
+{
+    return m_typeFlags[index] & Hidden;
+}
+
+bool FolderEntryTable::isWritable(int index) const
+{
+    return m_typeFlags[index] & Writable;
+}
+
+bool FolderEntryTable::isSystem(int index) const
+{
+    return m_typeFlags[index] & System;
+}
+
+bool FolderEntryTable::isDotDot(int index) const
+{
+    return m_typeFlags[index] & DotDot;
+}
+
+qint64 FolderEntryTable::size(int index) const
+{
+    return m_sizes[index];
+}
+
+qint64 FolderEntryTable::lastModified(int index) const
+{
+    return m_lastModifieds[index];
+}
+
+qint64 FolderEntryTable::created(int index) const
+{
+    return m_createds[index];
+}
+
+QFile::Permissions FolderEntryTable::permissions(int index) const
+{
+    return QFile::Permissions(m_permissions[index]);
+}
+
+uint FolderEntryTable::ownerId(int index) const
+{
+    return m_ownerIds[index];
+}
+
+uint FolderEntryTable::groupId(int index) const
+{
+    return m_groupIds[index];
+}
+
+// QString::operator<() と同じく UTF-16 のコード単位で比較する
+int FolderEntryTable::compareString(const QChar* l_data, int l_length, const QChar* r_data, int r_length)
+{
+    int length = qMin(l_length, r_length);
+    for(int i = 0;i < length;i++)
+    {
+        if(l_data[i] != r_data[i])
+        {
+            return (l_data[i].unicode() < r_data[i].unicode()) ? -1 : 1;
+        }
+    }
+
+    return l_length - r_length;
+}
+
+}           // namespace Farman
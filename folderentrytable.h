@@ -0,0 +1,127 @@
+﻿#ifndef FOLDERENTRYTABLE_H
+#define FOLDERENTRYTABLE_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaType>
+
+namespace Farman
+{
+
+// フォルダ内エントリの属性を列ごとの配列で保持するテーブル
+// (名前は 1 本の文字列に連結して保持する)
+class FolderEntryTable
+{
+public:
+    enum TypeFlag : int
+    {
+        Dir      = (1 << 0),
+        File     = (1 << 1),
+        SymLink  = (1 << 2),
+        Hidden   = (1 << 3),
+        Writable = (1 << 4),
+        System   = (1 << 5),            // Windows のみ
+        DotDot   = (1 << 6),            // ".."
+    };
+
+    // stat で取得する属性(取得していない列は 0 になる)
+    enum StatField : int
+    {
+        NoStatField = 0,
+
+        SizeField   = (1 << 0),         // size
+        TimeField   = (1 << 1),         // lastModified, created
+        OwnerField  = (1 << 2),         // ownerId, groupId
+        ModeField   = (1 << 3),         // permissions, Writable
+
+        AllStatFields = SizeField | TimeField | OwnerField | ModeField,
+    };
+
+    FolderEntryTable();
+
+    int count() const;
+    bool isEmpty() const;
+    void reserve(int size);
+    void clear();
+
+    void setStatFields(int statFields);
+    int statFields() const;
+
+    int append(const QFileInfo& fileInfo);
+    int append(const QString& fileName, int typeFlags, qint64 size, qint64 lastModified, qint64 created,
+               QFile::Permissions permissions, uint ownerId, uint groupId);
+    void append(const QFileInfoList& fileInfoList);
+    void append(const FolderEntryTable& other);
+
+    bool isAttributeChanged(int index, const FolderEntryTable& other, int otherIndex) const;
+    void setAttributes(int index, const FolderEntryTable& other, int otherIndex, int statFields);    // statFields の列のみ上書きする
+
+    // 列をそのまま並べたバイナリ(8 バイト境界に揃える)との変換(ディスクキャッシュ用)
+    QByteArray serialize() const;
+    bool deserialize(const char* data, qint64 size);
+
+    int indexOf(const QString& fileName) const;             // 無ければ -1
+
+    QString fileName(int index) const;
+    QString completeBaseName(int index) const;
+    QString suffix(int index) const;
+
+    // 比較用の生データ(folded = true の場合は小文字化した名前)
+    const QChar* nameData(int index, bool folded) const;
+    int nameLength(int index, bool folded) const;
+    int baseNameLength(int index, bool folded) const;       // 最後の '.' より前の長さ('.' が無ければ nameLength)
+
+    int typeFlags(int index) const;
+    bool isDir(int index) const;
+    bool isFile(int index) const;
+    bool isSymLink(int index) const;
+    bool isHidden(int index) const;
+    bool isWritable(int index) const;
+    bool isSystem(int index) const;
+    bool isDotDot(int index) const;
+
+    qint64 size(int index) const;
+    qint64 lastModified(int index) const;   // nsec since epoch(列挙方法によらず msec 精度、0 = 取得できない)
+    qint64 created(int index) const;        // nsec since epoch(列挙方法によらず msec 精度、0 = 取得できない)
+    QFile::Permissions permissions(int index) const;
+    uint ownerId(int index) const;
+    uint groupId(int index) const;
+
+    static int compareString(const QChar* l_data, int l_length, const QChar* r_data, int r_length);
+
+private:
+    static void appendName(const QString& name, QString& arena, QVector<int>& offsets,
+                           QVector<quint16>& lengths, QVector<quint16>& baseNameLengths);
+
+    QString m_nameArena;
+    QVector<int> m_nameOffsets;
+    QVector<quint16> m_nameLengths;
+    QVector<quint16> m_baseNameLengths;
+
+    QString m_foldedNameArena;
+    QVector<int> m_foldedNameOffsets;
+    QVector<quint16> m_foldedNameLengths;
+    QVector<quint16> m_foldedBaseNameLengths;
+
+    QVector<quint8> m_typeFlags;
+    QVector<qint64> m_sizes;
+    QVector<qint64> m_lastModifieds;
+    QVector<qint64> m_createds;
+    QVector<quint16> m_permissions;
+    QVector<uint> m_ownerIds;
+    QVector<uint> m_groupIds;
+
+    int m_statFields;
+
+    mutable QHash<QString, int> m_nameIndex;                // fileName -> index(indexOf() で追加分のみ構築する)
+    mutable int m_indexedCount;                             // m_nameIndex に登録済みのエントリ数(同名があるとハッシュの件数と一致しない)
+};
+
+}           // namespace Farman
+
+Q_DECLARE_METATYPE(Farman::FolderEntryTable)
+
+#endif // FOLDERENTRYTABLE_H
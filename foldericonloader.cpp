@@ -0,0 +1,86 @@
+﻿#include <QMutexLocker>
+#include <QMimeDatabase>
+#include "foldericonloader.h"
+
+namespace Farman
+{
+
+FolderIconLoader::FolderIconLoader(QObject *parent/* = Q_NULLPTR*/)
+    : QThread(parent)
+    , m_mutex()
+    , m_waitCondition()
+    , m_requests()
+{
+}
+
+FolderIconLoader::~FolderIconLoader()
+{
+    stop();
+}
+
+void FolderIconLoader::requestIcon(const QString& key, const QString& filePath, bool matchContent)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_requests.push_back({key, filePath, matchContent});
+    m_waitCondition.wakeOne();
+
+    locker.unlock();
+
+    if(!isRunning())
+    {
+        start(QThread::LowPriority);
+    }
+}
+
+void FolderIconLoader::clearRequests()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_requests.clear();
+}
+
+void FolderIconLoader::stop()
+{
+    if(!isRunning())
+    {
+        return;
+    }
+
+    requestInterruption();
+
+    m_mutex.lock();
+    m_waitCondition.wakeAll();
+    m_mutex.unlock();
+
+    wait();
+}
+
+void FolderIconLoader::run()
+{
+    QMimeDatabase mimeDatabase;
+
+    while(!isInterruptionRequested())
+    {
+        m_mutex.lock();
+        while(m_requests.isEmpty() && !isInterruptionRequested())
+        {
+            m_waitCondition.wait(&m_mutex);
+        }
+        if(isInterruptionRequested())
+        {
+            m_mutex.unlock();
+            break;
+        }
+        Request request = m_requests.takeFirst();
+        m_mutex.unlock();
+
+        // 拡張子で判定できない場合は内容を読むので、GUI スレッドでは行わない
+        QMimeType mimeType = mimeDatabase.mimeTypeForFile(request.filePath,
+                                                          (request.matchContent) ? QMimeDatabase::MatchDefault : QMimeDatabase::MatchExtension);
+
+        emit iconNameResolved(request.key, mimeType.iconName(), mimeType.genericIconName());
+    }
+}
+
+}           // namespace Farman
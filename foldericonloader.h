@@ -0,0 +1,49 @@
+﻿#ifndef FOLDERICONLOADER_H
+#define FOLDERICONLOADER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QString>
+
+namespace Farman
+{
+
+// ファイル毎のアイコン名(MIME タイプ)の判定をワーカースレッドで行う
+// QIcon / QPixmap は GUI スレッドでしか扱えないので、ここではアイコン名のみ返す
+class FolderIconLoader : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit FolderIconLoader(QObject *parent = Q_NULLPTR);
+    ~FolderIconLoader() Q_DECL_OVERRIDE;
+
+    // matchContent = false の場合は名前(拡張子)のみで判定する(拡張子ごとに共有するアイコン用)
+    void requestIcon(const QString& key, const QString& filePath, bool matchContent);
+    void clearRequests();
+    void stop();
+
+Q_SIGNALS:
+    void iconNameResolved(const QString& key, const QString& iconName, const QString& genericIconName);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    struct Request
+    {
+        QString key;
+        QString filePath;
+        bool matchContent;
+    };
+
+    QMutex m_mutex;
+    QWaitCondition m_waitCondition;
+    QList<Request> m_requests;
+};
+
+}           // namespace Farman
+
+#endif // FOLDERICONLOADER_H
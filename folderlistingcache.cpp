@@ -0,0 +1,171 @@
+﻿#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <cstring>
+#include "folderlistingcache.h"
+
+namespace Farman
+{
+
+namespace
+{
+
+const quint32 CacheMagic = 0x434c4d46;              // "FMLC"
+const quint32 CacheVersion = 1;
+
+struct CacheHeader
+{
+    quint32 magic;
+    quint32 version;
+    qint64 lastModified;                // ディレクトリの更新日時(msec since epoch)
+    qint32 pathLength;                  // 続くパス(UTF-16)の長さ
+    qint32 reserved;
+};
+
+qint64 folderLastModified(const QString& path)
+{
+    return QFileInfo(path).lastModified().toMSecsSinceEpoch();
+}
+
+}           // namespace
+
+FolderListingCache::FolderListingCache()
+    : m_cacheDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/listing")
+    , m_maxCount(64)
+{
+}
+
+void FolderListingCache::setCacheDir(const QString& cacheDir)
+{
+    m_cacheDir = cacheDir;
+}
+
+QString FolderListingCache::cacheDir() const
+{
+    return m_cacheDir;
+}
+
+void FolderListingCache::setMaxCount(int maxCount)
+{
+    m_maxCount = maxCount;
+}
+
+int FolderListingCache::maxCount() const
+{
+    return m_maxCount;
+}
+
+int FolderListingCache::load(const QString& path, FolderEntryTable& entryTable) const
+{
+    QFile file(cacheFilePath(path));
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return -1;
+    }
+
+    qint64 size = file.size();
+    if(size < static_cast<qint64>(sizeof(CacheHeader)))
+    {
+        return -1;
+    }
+
+    const uchar* data = file.map(0, size);
+    if(data == Q_NULLPTR)
+    {
+        return -1;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    // 壊れたファイルで範囲外を参照しないように、パスの長さは int で計算する前に確認する
+    qint64 headerSize = static_cast<qint64>(sizeof(header));
+    if(header.magic != CacheMagic || header.version != CacheVersion || header.pathLength < 0 ||
+       static_cast<qint64>(header.pathLength) > (size - headerSize) / 2)
+    {
+        return -1;
+    }
+    qint64 pathSize = static_cast<qint64>(header.pathLength) * 2;
+
+    // ファイル名はパスのハッシュなので、衝突していないかパスも照合する
+    QString cachedPath(reinterpret_cast<const QChar*>(data + sizeof(header)), header.pathLength);
+    if(cachedPath != path || header.lastModified != folderLastModified(path))
+    {
+        return -1;
+    }
+
+    qint64 offset = (headerSize + pathSize + 7) / 8 * 8;
+    if(offset > size)
+    {
+        return -1;
+    }
+
+    if(!entryTable.deserialize(reinterpret_cast<const char*>(data + offset), size - offset))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+int FolderListingCache::save(const QString& path, const FolderEntryTable& entryTable) const
+{
+    if(!QDir().mkpath(m_cacheDir))
+    {
+        return -1;
+    }
+
+    CacheHeader header;
+    header.magic = CacheMagic;
+    header.version = CacheVersion;
+    header.lastModified = folderLastModified(path);
+    header.pathLength = path.size();
+    header.reserved = 0;
+
+    QByteArray data(reinterpret_cast<const char*>(&header), sizeof(header));
+    data.append(reinterpret_cast<const char*>(path.constData()), path.size() * 2);
+    data.append(QByteArray((8 - data.size() % 8) % 8, '\0'));
+    data.append(entryTable.serialize());
+
+    // 書き込み途中のファイルを読まないように、書き終えてから置き換える
+    QSaveFile file(cacheFilePath(path));
+    if(!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+    {
+        return -1;
+    }
+
+    prune();
+
+    return 0;
+}
+
+void FolderListingCache::clear() const
+{
+    QDir dir(m_cacheDir);
+    foreach(const QString& fileName, dir.entryList({"*.listing"}, QDir::Files))
+    {
+        dir.remove(fileName);
+    }
+}
+
+QString FolderListingCache::cacheFilePath(const QString& path) const
+{
+    QByteArray hash = QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Sha1).toHex();
+
+    return m_cacheDir + "/" + QString::fromLatin1(hash) + ".listing";
+}
+
+void FolderListingCache::prune() const
+{
+    QDir dir(m_cacheDir);
+    QFileInfoList fileInfoList = dir.entryInfoList({"*.listing"}, QDir::Files, QDir::Time);
+    for(int i = m_maxCount;i < fileInfoList.count();i++)
+    {
+        QFile::remove(fileInfoList[i].filePath());
+    }
+}
+
+}           // namespace Farman
@@ -0,0 +1,36 @@
+﻿#ifndef FOLDERLISTINGCACHE_H
+#define FOLDERLISTINGCACHE_H
+
+#include <QString>
+#include "folderentrytable.h"
+
+namespace Farman
+{
+
+// ディレクトリの一覧をディレクトリ毎に 1 ファイルで保存し、次に開く際に読み込む
+// ファイルはディレクトリのパスと更新日時で照合し、そのままメモリにマップして読み込む
+class FolderListingCache
+{
+public:
+    FolderListingCache();
+
+    void setCacheDir(const QString& cacheDir);
+    QString cacheDir() const;
+    void setMaxCount(int maxCount);         // 保持するディレクトリ数の上限(古いものから削除する)
+    int maxCount() const;
+
+    int load(const QString& path, FolderEntryTable& entryTable) const;          // 0 = 成功, -1 = 無い・古い
+    int save(const QString& path, const FolderEntryTable& entryTable) const;    // 複数のスレッドから呼べる
+    void clear() const;
+
+private:
+    QString cacheFilePath(const QString& path) const;
+    void prune() const;
+
+    QString m_cacheDir;
+    int m_maxCount;
+};
+
+}           // namespace Farman
+
+#endif // FOLDERLISTINGCACHE_H
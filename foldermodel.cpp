@@ -3,15 +3,40 @@
 #include <QIcon>
 #include <QBrush>
 #include <QFontMetrics>
+#include <QSet>
 #include <QDebug>
-#include "misc.h"
+#include <QThread>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <numeric>
+#include "folderscanner.h"
+#include "foldertreescanner.h"
+#include "foldericonloader.h"
+#include "foldersizecalculator.h"
+#include "folderstatloader.h"
 #include "foldermodel.h"
 #ifdef Q_OS_WIN
 #include "win32.h"
 #endif
+#ifdef Q_OS_LINUX
+#include "linux.h"
+#endif
 namespace Farman
 {
 
+Q_LOGGING_CATEGORY(folderModelLog, "farman.foldermodel", QtWarningMsg)
+
+namespace
+{
+
+// FolderEntryTable の時刻(nsec)を QDateTime にする(0 = 取得できなかった時刻は無効な QDateTime)
+QDateTime nsecsToDateTime(qint64 nsecs)
+{
+    return (nsecs != 0) ? QDateTime::fromMSecsSinceEpoch(nsecs / 1000000) : QDateTime();
+}
+
+}           // namespace
+
 FolderModel::FolderModel(QObject *parent/* = Q_NULLPTR*/)
     : QAbstractTableModel(parent)
     , m_itemSelectionModel(this)
@@ -19,23 +44,93 @@ FolderModel::FolderModel(QObject *parent/* = Q_NULLPTR*/)
     , m_fileSystemWatcher(this)
     , m_rootPath("")
     , m_dir()
+    , m_entryTable()
+    , m_entryOrder()
+    , m_entryOrderSorted(false)
+    , m_rowList()
+    , m_entryRows()
+    , m_counts()
+    , m_asyncLoading(false)
+    , m_scanner(Q_NULLPTR)
+    , m_scanId(0)
+    , m_loadedNum(0)
+    , m_scanUpdating(false)
+    , m_updatePending(false)
+    , m_pendingEntryTable()
+    , m_recursiveListing(false)
+    , m_recursiveMaxDepth(-1)
+    , m_scannedSkipTypeFlags(0)
+    , m_incrementalFetch(false)
+    , m_fetchBatchSize(1000)
+    , m_fetchLimit(-1)
+    , m_lazyStat(false)
+    , m_statLoader(new FolderStatLoader(this))
+    , m_statRequestId(0)
+    , m_statLoaded()
+    , m_requestedStatEntries()
+    , m_statRequestTimer(this)
+    , m_pendingStatResults()
+    , m_listingCacheEnabled(false)
+    , m_listingCache()
+    , m_listingCacheSaveTimer(this)
+    , m_searchResult(false)
+    , m_searchCondition()
+    , m_searchNameRegExp()
+    , m_searchStatistics()
+    , m_autoUpdate(true)
+    , m_updateTimer(this)
+    , m_ownerNameCache()
+    , m_groupNameCache()
+    , m_folderSizeEnabled(false)
+    , m_folderSizeCalculator(new FolderSizeCalculator(this))
+    , m_folderSizes()
+    , m_pendingFolderSizes()
     , m_filterFlags(FilterFlag::AllEntrys)
     , m_nameFilters({"*"})
-    , m_sortSectionType(SectionType::FileName)
-    , m_sortSectionType2nd(SectionType::Unknown)
+    , m_nameFilterRegExp()
+    , m_nameFilterMatchAll(true)
+    , m_sortKeys({{SectionType::FileName, SortOrderType::Ascending}})
     , m_sortDirsType(SortDirsType::NoSpecify)
     , m_sortDotFirst(true)
     , m_sortOrder(SortOrderType::Ascending)
     , m_sortCaseSensitivity(SortCaseSensitivity::Insensitive)
+    , m_sortNaturalOrder(false)
+    , m_sortLocaleAware(false)
+    , m_parallelSort(true)
+    , m_parallelSortThreshold(100000)
+    , m_visibleFirstSort(false)
+    , m_visibleFirstSortThreshold(100000)
+    , m_visibleFirstRow(0)
+    , m_visibleRowCount(100)
+    , m_backgroundSorting(false)
+    , m_sortWatcher()
+    , m_naturalKeyArena()
+    , m_naturalKeyOffsets()
+    , m_naturalKeyLengths()
+    , m_collationKeys()
+    , m_compiledSortKeys()
+    , m_ownerRanks()
+    , m_groupRanks()
     , m_fileSizeFormatType(FileSizeFormatType::SI)
     , m_fileSizeComma(false)
     , m_permissionsFormatType(PermissionsFormatType::Symbolic)
     , m_dateFormatType(DateFormatType::Default)
     , m_dateFormatOriginalString("yyyy-MM-dd HH:mm:ss")
+    , m_locale()
+    , m_englishLocale(QLocale::English)
+    , m_displayTextCache()
     , m_font()
-    , m_brushes()
+    , m_brushes(static_cast<int>(ColorRoleType::FolderViewColorRoleTypeNum))
+    , m_colorRoles()
     , m_iconSize(16)
+    , m_iconLoader(new FolderIconLoader(this))
+    , m_iconCache()
+    , m_pendingIconKeys()
+    , m_iconUpdatedEntries()
+    , m_iconUpdateTimer(this)
     , m_folderColorTopPriority(false)
+    , m_statisticsEnabled(false)
+    , m_statistics()
 {
     m_sectionTypeList =
     {
@@ -49,12 +144,74 @@ FolderModel::FolderModel(QObject *parent/* = Q_NULLPTR*/)
         SectionType::LastModified,
     };
 
-    m_dir.setFilter(QDir::AllEntries | QDir::AccessMask | QDir::NoDot);
+    // 隠し・システムファイルも含めて列挙し、FilterFlag による絞り込みは isAcceptedEntry() で行う(Linux::readFolderEntries と同じ一覧にする)
+    m_dir.setFilter(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::AccessMask | QDir::NoDot);
     m_dir.setNameFilters({"..", "*"});
+
+    qRegisterMetaType<FolderEntryTable>("FolderEntryTable");
+    qRegisterMetaType<FolderSearchStatistics>("FolderSearchStatistics");
+    qRegisterMetaType<QVector<int>>("QVector<int>");
+
+    // ディレクトリの変更通知は一定時間まとめてから差分を反映する
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(200);
+
+    connect(&m_fileSystemWatcher, SIGNAL(directoryChanged(QString)), this, SLOT(onDirectoryChanged(QString)));
+    connect(&m_updateTimer, SIGNAL(timeout()), this, SLOT(onUpdateTimerTimeout()));
+
+    // 更新の多いフォルダで一覧全体を書き直し続けないように、差分の保存は間引く
+    m_listingCacheSaveTimer.setSingleShot(true);
+    m_listingCacheSaveTimer.setInterval(10000);
+
+    connect(&m_listingCacheSaveTimer, SIGNAL(timeout()), this, SLOT(onListingCacheSaveTimerTimeout()));
+
+    // 非同期に判定したアイコンは、まとめて再描画させる
+    m_iconUpdateTimer.setSingleShot(true);
+    m_iconUpdateTimer.setInterval(50);
+
+    connect(m_iconLoader, SIGNAL(iconNameResolved(QString,QString,QString)), this, SLOT(onIconNameResolved(QString,QString,QString)));
+    connect(&m_iconUpdateTimer, SIGNAL(timeout()), this, SLOT(onIconUpdateTimerTimeout()));
+
+    // 途中経過も計算済みの値と同じく表示に反映する
+    connect(m_folderSizeCalculator, SIGNAL(sizeProgress(QString,qint64)), this, SLOT(onFolderSizeCalculated(QString,qint64)));
+    connect(m_folderSizeCalculator, SIGNAL(sizeCalculated(QString,qint64)), this, SLOT(onFolderSizeCalculated(QString,qint64)));
+    connect(m_folderSizeCalculator, SIGNAL(allCalculated()), this, SLOT(onAllFolderSizesCalculated()));
+
+    connect(&m_sortWatcher, SIGNAL(finished()), this, SLOT(onBackgroundSortFinished()));
+
+    // data() で要求された行は、まとめて表示範囲に近い順に並べてから stat させる
+    m_statRequestTimer.setSingleShot(true);
+    m_statRequestTimer.setInterval(0);
+
+    connect(m_statLoader, SIGNAL(statLoaded(int,QVector<int>,FolderEntryTable)), this, SLOT(onStatLoaded(int,QVector<int>,FolderEntryTable)));
+    connect(&m_statRequestTimer, SIGNAL(timeout()), this, SLOT(onStatRequestTimerTimeout()));
 }
 
 FolderModel::~FolderModel()
 {
+    flushListingCache();
+
+    if(m_scanner != Q_NULLPTR)
+    {
+        m_scanner->disconnect(this);
+        m_scanner->cancel();
+        m_scanner->wait();
+
+        delete m_scanner;
+    }
+
+    m_iconLoader->disconnect(this);
+    m_iconLoader->stop();
+
+    m_folderSizeCalculator->disconnect(this);
+    m_folderSizeCalculator->cancel();
+
+    m_statLoader->disconnect(this);
+    m_statLoader->stop();
+
+    // ソート中のスレッドは this を参照しているので終わるまで待つ
+    m_sortWatcher.disconnect(this);
+    m_sortWatcher.waitForFinished();
 }
 
 QVariant FolderModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -103,7 +260,7 @@ int FolderModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
 
-    return m_fileInfoList.count();
+    return m_rowList.count();
 }
 
 int FolderModel::columnCount(const QModelIndex &parent) const
@@ -113,6 +270,28 @@ int FolderModel::columnCount(const QModelIndex &parent) const
     return m_sectionTypeList.count();
 }
 
+bool FolderModel::canFetchMore(const QModelIndex &parent) const
+{
+    if(parent.isValid() || m_fetchLimit < 0 || m_scanner == Q_NULLPTR)
+    {
+        return false;
+    }
+
+    // 要求した分を全て受け取っていれば、スキャナは次の要求を待っている
+    return m_loadedNum >= m_fetchLimit;
+}
+
+void FolderModel::fetchMore(const QModelIndex &parent)
+{
+    if(!canFetchMore(parent))
+    {
+        return;
+    }
+
+    m_fetchLimit += m_fetchBatchSize;
+    m_scanner->setFetchLimit(m_fetchLimit);
+}
+
 QVariant FolderModel::data(const QModelIndex &index, int role) const
 {
     if(!index.isValid() || index.column() >= m_sectionTypeList.count())
@@ -129,106 +308,10 @@ QVariant FolderModel::data(const QModelIndex &index, int role) const
     case Qt::DisplayRole:
     case Qt::EditRole:
     {
-        QFileInfo fi = fileInfo(index);
-
-        switch(sectionType)
-        {
-        case SectionType::FileName:
-            if(!fi.isDir() && !fi.completeBaseName().isEmpty())
-            {
-                ret = fi.completeBaseName();
-            }
-            else
-            {
-                ret = fi.fileName();
-            }
-            break;
-
-        case SectionType::FileType:
-            if(!fi.isDir() && !fi.completeBaseName().isEmpty())
-            {
-                ret = fi.suffix();
-            }
-            break;
-
-        case SectionType::FileSize:
-            if(fi.isDir())
-            {
-                ret = QString("<Folder>");
-            }
-            else
-            {
-                if(m_fileSizeFormatType == FileSizeFormatType::Detail)
-                {
-                    ret = (m_fileSizeComma) ? QLocale(QLocale::English).toString(fi.size()) : QString::number(fi.size());
-                }
-                else
-                {
-                    ret = QLocale().formattedDataSize(fi.size(), 2,
-                                                      (m_fileSizeFormatType == FileSizeFormatType::IEC) ? QLocale::DataSizeIecFormat :
-                                                                                                          QLocale::DataSizeSIFormat);
-                }
-            }
-            break;
-
-        case SectionType::Owner:
-            ret = fi.owner();
-
-            break;
-
-        case SectionType::Group:
-            ret = fi.group();
-
-            break;
-
-        case SectionType::Permissions:
-            if(m_permissionsFormatType == PermissionsFormatType::Absolute)
-            {
-                ret = QString::number(static_cast<int>(fi.permissions()) & 0x0FFF, 16);
-            }
-            else
-            {
-                QFile::Permissions perms = fi.permissions();
-
-                ret =  QString("%1%2%3%4%5%6%7%8%9%10")
-                        .arg(fi.isDir() ? "d" : "-")
-                        .arg(perms & QFile::ReadUser   ? "r" : "-")
-                        .arg(perms & QFile::WriteUser  ? "w" : "-")
-                        .arg(perms & QFile::ExeUser    ? "x" : "-")
-                        .arg(perms & QFile::ReadGroup  ? "r" : "-")
-                        .arg(perms & QFile::WriteGroup ? "w" : "-")
-                        .arg(perms & QFile::ExeGroup   ? "x" : "-")
-                        .arg(perms & QFile::ReadOther  ? "r" : "-")
-                        .arg(perms & QFile::WriteOther ? "w" : "-")
-                        .arg(perms & QFile::ExeOther   ? "x" : "-");
-            }
-
-            break;
-
-        case SectionType::Created:
-        case SectionType::LastModified:
+        int entry = entryIndex(index);
+        if(entry >= 0)
         {
-            QDateTime time = (sectionType == SectionType::Created) ? fi.birthTime() : fi.lastModified();
-
-            switch(m_dateFormatType)
-            {
-            case DateFormatType::ISO:
-                ret = time.toString(Qt::ISODate);
-                break;
-            case DateFormatType::Original:
-            {
-                ret = time.toString(m_dateFormatOriginalString);
-                break;
-            }
-            case DateFormatType::Default:
-            default:
-                ret = time.toString(Qt::TextDate);
-                break;
-            }
-            break;
-        }
-        default:
-            break;
+            ret = displayText(entry, index.column());
         }
 
         break;
@@ -265,7 +348,11 @@ QVariant FolderModel::data(const QModelIndex &index, int role) const
     case FileIconRole:
         if(sectionType == SectionType::FileName)
         {
-            ret = fileIcon(index).pixmap(m_iconSize, m_iconSize);
+            int entry = entryIndex(index);
+            if(entry >= 0)
+            {
+                ret = iconPixmap(entry);
+            }
         }
 
         break;
@@ -293,10 +380,213 @@ QVariant FolderModel::data(const QModelIndex &index, int role) const
     return ret;
 }
 
+// 表示文字列は行(エントリ)・列ごとに 1 度だけ整形してキャッシュする
+QString FolderModel::displayText(int entry, int column) const
+{
+    if(m_displayTextCache.count() != m_sectionTypeList.count())
+    {
+        m_displayTextCache.resize(m_sectionTypeList.count());
+    }
+
+    QVector<QString>& columnCache = m_displayTextCache[column];
+    if(columnCache.count() < m_entryTable.count())
+    {
+        columnCache.resize(m_entryTable.count());
+    }
+
+    if(m_lazyStat && !isStatLoaded(entry, statFieldOf(m_sectionTypeList[column])))
+    {
+        // 属性を取得するまでは空欄にする(取得後に dataChanged() を通知する)
+        requestStat(entry);
+
+        return QString("");
+    }
+
+    // 未整形のものは null 文字列(整形結果が空の場合は "" を保持する)
+    QString& text = columnCache[entry];
+    if(text.isNull())
+    {
+        if(m_statisticsEnabled)
+        {
+            m_statistics.displayTextCacheMisses++;
+        }
+
+        text = formatDisplayText(entry, m_sectionTypeList[column]);
+        if(text.isNull())
+        {
+            text = QString("");
+        }
+    }
+    else if(m_statisticsEnabled)
+    {
+        m_statistics.displayTextCacheHits++;
+    }
+
+    return text;
+}
+
+QString FolderModel::formatDisplayText(int entry, SectionType sectionType) const
+{
+    QString text;
+
+    bool isDirEntry = m_entryTable.isDir(entry);
+    bool hasBaseName = (!isDirEntry && m_entryTable.baseNameLength(entry, false) > 0);
+
+    switch(sectionType)
+    {
+    case SectionType::FileName:
+        if(hasBaseName)
+        {
+            text = m_entryTable.completeBaseName(entry);
+        }
+        else
+        {
+            text = m_entryTable.fileName(entry);
+        }
+        break;
+
+    case SectionType::FileType:
+        if(hasBaseName)
+        {
+            text = m_entryTable.suffix(entry);
+        }
+        break;
+
+    case SectionType::FileSize:
+        if(isDirEntry && sizeKey(entry) < 0)
+        {
+            text = QString("<Folder>");
+        }
+        else
+        {
+            qint64 size = sizeKey(entry);
+
+            if(m_fileSizeFormatType == FileSizeFormatType::Detail)
+            {
+                text = (m_fileSizeComma) ? m_englishLocale.toString(size) : QString::number(size);
+            }
+            else
+            {
+                text = m_locale.formattedDataSize(size, 2,
+                                                   (m_fileSizeFormatType == FileSizeFormatType::IEC) ? QLocale::DataSizeIecFormat :
+                                                                                                       QLocale::DataSizeSIFormat);
+            }
+        }
+        break;
+
+    case SectionType::Owner:
+        text = ownerName(entry);
+
+        break;
+
+    case SectionType::Group:
+        text = groupName(entry);
+
+        break;
+
+    case SectionType::Permissions:
+        if(m_permissionsFormatType == PermissionsFormatType::Absolute)
+        {
+            text = QString::number(static_cast<int>(m_entryTable.permissions(entry)) & 0x0FFF, 16);
+        }
+        else
+        {
+            static const QFile::Permission permissionBits[] =
+            {
+                QFile::ReadUser,  QFile::WriteUser,  QFile::ExeUser,
+                QFile::ReadGroup, QFile::WriteGroup, QFile::ExeGroup,
+                QFile::ReadOther, QFile::WriteOther, QFile::ExeOther,
+            };
+            static const char permissionChars[] = "rwxrwxrwx";
+
+            QFile::Permissions perms = m_entryTable.permissions(entry);
+
+            text = QString(10, '-');
+            if(isDirEntry)
+            {
+                text[0] = 'd';
+            }
+            for(int i = 0;i < 9;i++)
+            {
+                if(perms & permissionBits[i])
+                {
+                    text[i + 1] = permissionChars[i];
+                }
+            }
+        }
+
+        break;
+
+    case SectionType::Created:
+    case SectionType::LastModified:
+    {
+        qint64 nsecs = (sectionType == SectionType::Created) ? m_entryTable.created(entry) : m_entryTable.lastModified(entry);
+        QDateTime time = nsecsToDateTime(nsecs);
+        if(!time.isValid())
+        {
+            break;
+        }
+
+        switch(m_dateFormatType)
+        {
+        case DateFormatType::ISO:
+            text = time.toString(Qt::ISODate);
+            break;
+        case DateFormatType::Original:
+        {
+            text = time.toString(m_dateFormatOriginalString);
+            break;
+        }
+        case DateFormatType::Default:
+        default:
+            text = time.toString(Qt::TextDate);
+            break;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    return text;
+}
+
+void FolderModel::clearDisplayTexts()
+{
+    m_displayTextCache.clear();
+
+    if(!m_rowList.isEmpty())
+    {
+        emit dataChanged(index(0, 0), index(m_rowList.count() - 1, columnCount() - 1), {Qt::DisplayRole, Qt::EditRole});
+    }
+}
+
+void FolderModel::sort(int column, Qt::SortOrder order/* = Qt::AscendingOrder*/)
+{
+    if(column < 0 || column >= m_sectionTypeList.count())
+    {
+        return;
+    }
+
+    SectionType sectionType = m_sectionTypeList[column];
+    for(int i = m_sortKeys.count() - 1;i >= 1;i--)
+    {
+        if(m_sortKeys[i].sectionType == sectionType)
+        {
+            m_sortKeys.removeAt(i);
+        }
+    }
+
+    setSortSectionType(sectionType);
+    setSortOrder(static_cast<SortOrderType>(order));
+
+    resort();
+}
+
 QModelIndex FolderModel::index(int row, int column, const QModelIndex &parent/* = QModelIndex()*/) const
 {
-    row = Clamp(row, 0, m_fileInfoList.count() - 1);
-    column = Clamp(column, 0, m_sectionTypeList.size() - 1);
+    row = qBound(0, row, m_rowList.count() - 1);
+    column = qBound(0, column, m_sectionTypeList.size() - 1);
 
     QModelIndex ret = QAbstractTableModel::index(row, column, parent);
 
@@ -310,15 +600,20 @@ QModelIndex FolderModel::index(int row, int column, const QModelIndex &parent/*
 
 QModelIndex FolderModel::index(const QString &path) const
 {
-    for(int row = 0;row < m_fileInfoList.count();row++)
+    QString fileName = (m_recursiveListing || m_searchResult) ? m_dir.relativeFilePath(path) : path.mid(path.lastIndexOf('/') + 1);
+
+    int entry = m_entryTable.indexOf(fileName);
+    if(entry < 0 || entry >= m_entryRows.count() || m_entryRows[entry] < 0)
     {
-        if(m_fileInfoList[row].filePath() == path)
-        {
-            return index(row, 0);
-        }
+        return QModelIndex();
     }
 
-    return QModelIndex();
+    if(m_dir.filePath(fileName) != path)
+    {
+        return QModelIndex();
+    }
+
+    return index(m_entryRows[entry], 0);
 }
 
 int FolderModel::setRootPath(const QString& path)
@@ -331,8 +626,14 @@ int FolderModel::setRootPath(const QString& path)
     QString oldPath = m_rootPath;
     m_rootPath = path;
 
+    // 移動前のフォルダの保存していない差分を書き出す
+    flushListingCache();
+
     m_dir.setPath(path);
 
+    // 移動前のフォルダのサイズ計算は打ち切る
+    m_folderSizeCalculator->cancel();
+
     int ret = refresh();
     if(ret < 0)
     {
@@ -341,6 +642,9 @@ int FolderModel::setRootPath(const QString& path)
         return -1;
     }
 
+    updateWatchPath();
+    clearFileIcons();
+
     emitRootPathChanged(path);
 
     return 0;
@@ -351,376 +655,2416 @@ QString FolderModel::rootPath() const
     return m_rootPath;
 }
 
-int FolderModel::fileNum()
+int FolderModel::fileNum() const
 {
-    return getFileDirNum(FilterFlag::Files);
+    return m_counts.fileNum;
 }
 
-int FolderModel::dirNum()
+int FolderModel::dirNum() const
 {
-    return getFileDirNum(FilterFlag::Dirs);
+    return m_counts.dirNum;
 }
 
-int FolderModel::fileDirNum()
+int FolderModel::fileDirNum() const
 {
-    return getFileDirNum(FilterFlag::Files | FilterFlag::Dirs);
+    return m_counts.fileDirNum;
 }
 
-int FolderModel::getFileDirNum(FilterFlags filterFlags)
+FolderCounts FolderModel::counts() const
 {
-    QFileInfoList fileInfoList = m_dir.entryInfoList();
-    if(fileInfoList.isEmpty())
+    return m_counts;
+}
+
+void FolderModel::addCounts(int entry)
+{
+    if(m_entryTable.isDotDot(entry))
     {
-        return 0;
+        return;
     }
 
-    filterFlags &= m_filterFlags;       // Files / Dirs フラグは、引数(filterFlags)と m_filterFlags の両方で有効でなければならない
+    if(m_entryTable.isDir(entry))
+    {
+        m_counts.dirNum++;
+    }
+    else
+    {
+        m_counts.fileNum++;
+        m_counts.totalSize += m_entryTable.size(entry);
+    }
+    m_counts.fileDirNum++;
+}
+
+// エントリ -> 行の対応を作り直す(表示していないエントリは -1)
+void FolderModel::updateEntryRows()
+{
+    m_entryRows.fill(-1, m_entryTable.count());
 
-    int count = 0;
-    foreach(const QFileInfo& fileInfo, fileInfoList)
+    for(int row = 0;row < m_rowList.count();row++)
     {
-        if(fileInfo.fileName() == "..")
+        if(m_rowList[row] >= 0)
         {
-            continue;
-        }
-        else
-        {
-            if(fileInfo.isDir())
-            {
-                if(!(filterFlags & FilterFlag::Dirs))
-                {
-                    continue;
-                }
-            }
-            else if(fileInfo.isFile())
-            {
-                if(!(filterFlags & FilterFlag::Files))
-                {
-                    continue;
-                }
-            }
-
-            if(fileInfo.isHidden() && !(m_filterFlags & FilterFlag::Hidden))
-            {
-                continue;
-            }
-#ifdef Q_OS_WIN
-            if(Win32::isSystemFile(fileInfo.absoluteFilePath()) && !(m_filterFlags & FilterFlag::System))
-            {
-                continue;
-            }
-#endif
+            m_entryRows[m_rowList[row]] = row;
         }
-        count++;
     }
+}
 
-    return count;
+void FolderModel::recount()
+{
+    m_counts = FolderCounts();
+
+    foreach(int entry, m_rowList)
+    {
+        addCounts(entry);
+    }
 }
 
 int FolderModel::refresh()
 {
-    QFileInfoList fileInfoList = m_dir.entryInfoList();
-    if(fileInfoList.isEmpty())
+    m_searchResult = false;
+
+    FolderEntryTable entryTable;
+    if(isListingCacheUsable() && m_listingCache.load(m_dir.absolutePath(), entryTable) == 0)
+    {
+        cancelScan();
+        resetEntryTable(entryTable);
+
+        // 保存後の変更は差分として反映する
+        startScan(true);
+
+        return 0;
+    }
+
+    if(m_asyncLoading || m_recursiveListing || m_incrementalFetch)
+    {
+        return startScan();
+    }
+
+    cancelScan();
+
+    if(readEntryTable(entryTable) < 0)
     {
         qDebug() << "Entry list is Empty.";
 
         return -1;
     }
 
+    resetEntryTable(entryTable);
+    saveListingCache();
+
+    return 0;
+}
+
+void FolderModel::resetEntryTable(const FolderEntryTable& entryTable)
+{
+    finishBackgroundSort();
+
     beginResetModel();
 
-    m_fileInfoList.clear();
+    m_entryTable = entryTable;
+    m_scannedSkipTypeFlags = 0;
+    clearSortKeys();
+    clearStats();
+    m_displayTextCache.clear();
+    updateColorRoles();
+    updateFolderSizes();
 
-    foreach(const QFileInfo& fileInfo, fileInfoList)
+    bool visibleFirst = isVisibleFirstSortTarget(m_entryTable.count());
+    if(visibleFirst)
     {
-        if(fileInfo.fileName() == "..")
-        {
-            if(m_dir.isRoot())
-            {
-                continue;
-            }
-        }
-        else
-        {
-            if(fileInfo.isDir())
-            {
-                if(!(m_filterFlags & FilterFlag::Dirs))
-                {
-                    continue;
-                }
-            }
-            else if(fileInfo.isFile())
-            {
-                if(!(m_filterFlags & FilterFlag::Files))
-                {
-                    continue;
-                }
-            }
+        // 表示範囲の行だけを並べて先に表示する(m_entryOrder は refilter() で必要になるまで並べない)
+        m_entryOrder.resize(m_entryTable.count());
+        std::iota(m_entryOrder.begin(), m_entryOrder.end(), 0);
+        m_entryOrderSorted = false;
 
-            if(fileInfo.isHidden() && !(m_filterFlags & FilterFlag::Hidden))
-            {
-                continue;
-            }
-#ifdef Q_OS_WIN
-            if(Win32::isSystemFile(fileInfo.absoluteFilePath()) && !(m_filterFlags & FilterFlag::System))
-            {
-                continue;
-            }
-#endif
-        }
-        m_fileInfoList.push_back(fileInfo);
+        m_rowList = filterEntries(m_entryOrder);
+        partialSortEntries(m_rowList);
     }
+    else
+    {
+        sortEntryOrder();
+        m_rowList = filterEntries(m_entryOrder);
+    }
+    updateEntryRows();
+    recount();
 
-    std::sort(m_fileInfoList.begin(), m_fileInfoList.end(),
-          [this](const QFileInfo& l, const QFileInfo& r){ return this->lessThan(l, r); });
+    QElapsedTimer timer;
+    if(m_statisticsEnabled)
+    {
+        timer.start();
+    }
 
     endResetModel();
 
-    return 0;
+    if(m_statisticsEnabled)
+    {
+        m_statistics.resetTime += timer.nsecsElapsed();
+
+        logStatistics("refresh");
+    }
+
+    if(visibleFirst)
+    {
+        startBackgroundSort();
+    }
 }
 
-bool FolderModel::lessThan(const QFileInfo& l_info, const QFileInfo& r_info) const
+void FolderModel::resort()
 {
-//    qDebug() << "FolderModel::lessThan() : source_left : " << l_info.filePath() << ", source_right : " << r_info.filePath();
+    if(m_rowList.isEmpty())
+    {
+        return;
+    }
 
-    if(m_sortDotFirst)
+    if(requiredStatFields() & ~m_entryTable.statFields())
     {
-        if(l_info.fileName() == ".")
-        {
-            return true;
-        }
-        else if(r_info.fileName() == ".")
-        {
-            return false;
-        }
-        else if(l_info.fileName() == ".." && r_info.fileName() != ".")
-        {
-            return true;
-        }
-        else if(r_info.fileName() == ".." && l_info.fileName() != ".")
-        {
-            return false;
-        }
+        // ソートキーの属性を読み込んでいないので、読み直して差分として反映する
+        updateEntries();
+
+        return;
     }
 
-    if(m_sortDirsType == SortDirsType::First)
+    sortRowList();
+
+    m_entryOrderSorted = false;
+}
+
+bool FolderModel::isAcceptedEntry(int entry) const
+{
+    if(m_entryTable.isDotDot(entry))
     {
-        if(l_info.isDir() && !r_info.isDir())
-        {
-            return true;
-        }
-        else if(!l_info.isDir() && r_info.isDir())
+        return !m_dir.isRoot();
+    }
+
+    return isAcceptedEntry(entry, m_filterFlags);
+}
+
+bool FolderModel::isAcceptedEntry(int entry, FilterFlags filterFlags) const
+{
+    if(m_entryTable.isDir(entry))
+    {
+        if(!(filterFlags & FilterFlag::Dirs))
         {
             return false;
         }
     }
-    else if(m_sortDirsType == SortDirsType::Last)
+    else if(m_entryTable.isFile(entry))
     {
-        if(l_info.isDir() && !r_info.isDir())
+        if(!(filterFlags & FilterFlag::Files))
         {
             return false;
         }
-        else if(!l_info.isDir() && r_info.isDir())
+    }
+
+    if(m_entryTable.isHidden(entry) && !(filterFlags & FilterFlag::Hidden))
+    {
+        return false;
+    }
+    if(m_entryTable.isSystem(entry) && !(filterFlags & FilterFlag::System))
+    {
+        return false;
+    }
+
+    // 再帰表示の場合もファイル名の部分のみで判定する
+    int offset = relativeNameOffset(entry);
+
+    return matchNameFilters(m_entryTable.nameData(entry, false) + offset, m_entryTable.nameLength(entry, false) - offset);
+}
+
+// 相対パスのファイル名部分の開始位置(再帰表示・検索結果でなければ 0)
+int FolderModel::relativeNameOffset(int entry) const
+{
+    if(!m_recursiveListing && !m_searchResult)
+    {
+        return 0;
+    }
+
+    const QChar* name = m_entryTable.nameData(entry, false);
+    int offset = m_entryTable.nameLength(entry, false);
+    while(offset > 0 && name[offset - 1] != '/')
+    {
+        offset--;
+    }
+
+    return offset;
+}
+
+bool FolderModel::matchNameFilters(const QChar* fileName, int length) const
+{
+    if(m_nameFilterMatchAll)
+    {
+        return true;
+    }
+
+    return m_nameFilterRegExp.match(QString::fromRawData(fileName, length)).hasMatch();
+}
+
+QVector<int> FolderModel::filterEntries(const QVector<int>& entryList) const
+{
+    QElapsedTimer timer;
+    if(m_statisticsEnabled)
+    {
+        timer.start();
+    }
+
+    QVector<int> acceptedList;
+    acceptedList.reserve(entryList.count());
+    foreach(int entry, entryList)
+    {
+        if(isAcceptedEntry(entry))
         {
-            return true;
+            acceptedList.push_back(entry);
         }
     }
 
-    bool ascOrder = (m_sortOrder == SortOrderType::Ascending);
+    if(m_statisticsEnabled)
+    {
+        m_statistics.filterTime += timer.nsecsElapsed();
+        m_statistics.filteredOutNum += entryList.count() - acceptedList.count();
+    }
+
+    return acceptedList;
+}
+
+void FolderModel::sortRowList()
+{
+    finishBackgroundSort();
+
+    QVector<int> rowList = m_rowList;
+    if(isVisibleFirstSortTarget(rowList.count()))
+    {
+        partialSortEntries(rowList);
+        setSortedRowList(rowList);
+
+        startBackgroundSort();
+
+        return;
+    }
+
+    sortEntries(rowList);
+    setSortedRowList(rowList);
+}
+
+void FolderModel::setSortedRowList(const QVector<int>& rowList)
+{
+    emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+
+    QVector<int> oldRowList = m_rowList;
+    m_rowList = rowList;
+
+    updateEntryRows();
+
+    // 選択状態などが行に追従するように、永続インデックスを並び替え後の行に付け替える
+    QModelIndexList fromList = persistentIndexList();
+    QModelIndexList toList;
+    toList.reserve(fromList.count());
+    foreach(const QModelIndex& from, fromList)
+    {
+        toList.push_back(createIndex(m_entryRows[oldRowList[from.row()]], from.column()));
+    }
+    changePersistentIndexList(fromList, toList);
+
+    emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+}
+
+void FolderModel::sortEntries(QVector<int>& entryList) const
+{
+    QElapsedTimer timer;
+    if(m_statisticsEnabled)
+    {
+        timer.start();
+    }
+
+    // 比較キーは並列に比較する前に作っておく
+    updateSortKeys();
+    compileSortKeys();
 
-    return sectionTypeLessThan((ascOrder) ? l_info : r_info,
-                               (ascOrder) ? r_info : l_info,
-                               m_sortSectionType, m_sortSectionType2nd, m_sortCaseSensitivity);
+    qint64 compareNum = sortKeyedEntries(entryList);
+
+    if(m_statisticsEnabled)
+    {
+        m_statistics.sortTime += timer.nsecsElapsed();
+        m_statistics.compareNum += compareNum;
+    }
 }
 
-bool FolderModel::sectionTypeLessThan(const QFileInfo& l_info, const QFileInfo& r_info,
-                                   SectionType sectionType, SectionType sectionType2nd, SortCaseSensitivity caseSensitivity) const
+// 比較キーを作成済みのエントリを並べ替え、比較回数を返す(バックグラウンドのスレッドからも呼ぶ)
+qint64 FolderModel::sortKeyedEntries(QVector<int>& entryList) const
 {
-    if(sectionType == SectionType::FileSize)
+    // 比較回数はタスクごとに数える(常に数えても比較そのものに比べて無視できる)
+    auto sortRange = [this](int* first, int* last, qint64* compareNum)
+    {
+        std::sort(first, last, [this, compareNum](int l, int r){ ++*compareNum; return this->lessThan(l, r); });
+    };
+    auto mergeRange = [this](int* first, int* middle, int* last, qint64* compareNum)
+    {
+        std::inplace_merge(first, middle, last, [this, compareNum](int l, int r){ ++*compareNum; return this->lessThan(l, r); });
+    };
+
+    qint64 compareNum = 0;
+
+    int threadNum = QThread::idealThreadCount();
+    if(!m_parallelSort || entryList.count() < m_parallelSortThreshold || threadNum < 2)
+    {
+        sortRange(entryList.data(), entryList.data() + entryList.count(), &compareNum);
+    }
+    else
     {
-        if(!l_info.isDir() && !r_info.isDir())
+        // lessThan() はファイル名で同順位を解消するので、分割してソートしてからマージしても順序は std::sort と一致する
+        int* data = entryList.data();
+
+        QVector<int> bounds;
+        for(int i = 0;i <= threadNum;i++)
+        {
+            bounds.push_back(static_cast<int>(static_cast<qint64>(entryList.count()) * i / threadNum));
+        }
+
+        QVector<qint64> compareNums(threadNum, 0);
+
+        QVector<int> segments(threadNum);
+        std::iota(segments.begin(), segments.end(), 0);
+        QtConcurrent::blockingMap(segments, [&](int segment)
+        {
+            sortRange(data + bounds[segment], data + bounds[segment + 1], &compareNums[segment]);
+        });
+
+        // 隣り合う範囲を並列にマージしていく
+        while(bounds.count() > 2)
         {
-            if(sectionType2nd != SectionType::Unknown && l_info.size() == r_info.size())
+            QVector<int> merges;
+            for(int i = 0;i + 2 < bounds.count();i += 2)
             {
-                return sectionTypeLessThan(l_info, r_info, sectionType2nd, SectionType::Unknown, caseSensitivity);
+                merges.push_back(i);
             }
-            else
+
+            QtConcurrent::blockingMap(merges, [&](int i)
+            {
+                mergeRange(data + bounds[i], data + bounds[i + 1], data + bounds[i + 2], &compareNums[i / 2]);
+            });
+
+            QVector<int> mergedBounds;
+            for(int i = 0;i < bounds.count();i += 2)
             {
-                return l_info.size() < r_info.size();
+                mergedBounds.push_back(bounds[i]);
             }
-        }
-        else
-        {
-            if(sectionType2nd != SectionType::Unknown)
+            if(mergedBounds.last() != bounds.last())
             {
-                return sectionTypeLessThan(l_info, r_info, sectionType2nd, SectionType::Unknown, caseSensitivity);
+                mergedBounds.push_back(bounds.last());
             }
+            bounds = mergedBounds;
         }
-    }
-    else if(sectionType == SectionType::FileType)
-    {
-        QString l_type = (!l_info.isDir() && !l_info.completeBaseName().isEmpty()) ? l_info.suffix() : "";
-        QString r_type = (!r_info.isDir() && !r_info.completeBaseName().isEmpty()) ? r_info.suffix() : "";
 
-        if(l_type.isEmpty() && r_type.isEmpty())
+        foreach(qint64 num, compareNums)
         {
-            l_type = l_info.fileName();
-            r_type = r_info.fileName();
+            compareNum += num;
         }
+    }
 
-        if(caseSensitivity == SortCaseSensitivity::Insensitive)
-        {
-            l_type = l_type.toLower();
-            r_type = r_type.toLower();
-        }
+    return compareNum;
+}
 
-        if(sectionType2nd != SectionType::Unknown && l_type == r_type)
-        {
-            return sectionTypeLessThan(l_info, r_info, sectionType2nd, SectionType::Unknown, caseSensitivity);
-        }
-        else
+void FolderModel::sortEntryOrder()
+{
+    finishBackgroundSort();
+
+    m_entryOrder.resize(m_entryTable.count());
+    std::iota(m_entryOrder.begin(), m_entryOrder.end(), 0);
+
+    sortEntries(m_entryOrder);
+
+    m_entryOrderSorted = true;
+}
+
+bool FolderModel::isVisibleFirstSortTarget(int count) const
+{
+    return m_visibleFirstSort && count >= m_visibleFirstSortThreshold && count > m_visibleRowCount;
+}
+
+// 表示範囲の行だけを全体をソートした場合と同じ順に並べる(範囲外の行の順序は不定)
+void FolderModel::partialSortEntries(QVector<int>& entryList) const
+{
+    QElapsedTimer timer;
+    if(m_statisticsEnabled)
+    {
+        timer.start();
+    }
+
+    updateSortKeys();
+    compileSortKeys();
+
+    qint64 compareNum = 0;
+    auto compare = [this, &compareNum](int l, int r){ ++compareNum; return this->lessThan(l, r); };
+
+    int count = entryList.count();
+    int first = qBound(0, m_visibleFirstRow, qMax(0, count - m_visibleRowCount));
+    int last = qMin(first + m_visibleRowCount, count);
+    int* data = entryList.data();
+
+    // 表示範囲より前に来る行を先頭側に寄せてから(O(n))、表示範囲の行だけを並べる(O(n log k))
+    if(first > 0)
+    {
+        std::nth_element(data, data + first, data + count, compare);
+    }
+    std::partial_sort(data + first, data + last, data + count, compare);
+
+    if(m_statisticsEnabled)
+    {
+        m_statistics.sortTime += timer.nsecsElapsed();
+        m_statistics.compareNum += compareNum;
+    }
+}
+
+// m_rowList 全体の並べ替えを別スレッドで始める
+// (比較キーは partialSortEntries() で作成済み。結果を反映するまで比較に使うメンバは変更しない)
+void FolderModel::startBackgroundSort()
+{
+    QVector<int> rowList = m_rowList;
+
+    m_backgroundSorting = true;
+    m_sortWatcher.setFuture(QtConcurrent::run([this, rowList]()
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        SortResult result;
+        result.rowList = rowList;
+        result.compareNum = sortKeyedEntries(result.rowList);
+        result.sortTime = timer.nsecsElapsed();
+
+        return result;
+    }));
+}
+
+// バックグラウンドのソートが終わるのを待って結果を反映する
+// (エントリやソート条件を変更する前に呼ぶ)
+void FolderModel::finishBackgroundSort()
+{
+    if(!m_backgroundSorting)
+    {
+        return;
+    }
+
+    m_backgroundSorting = false;
+    m_sortWatcher.waitForFinished();
+
+    SortResult result = m_sortWatcher.result();
+    if(m_statisticsEnabled)
+    {
+        m_statistics.sortTime += result.sortTime;
+        m_statistics.compareNum += result.compareNum;
+    }
+
+    setSortedRowList(result.rowList);
+
+    if(m_statisticsEnabled)
+    {
+        logStatistics("background sort");
+    }
+
+    applyPendingResults();
+}
+
+void FolderModel::applyPendingResults()
+{
+    // ソート中はテーブルを書き換えられないので、受け取った結果をここでまとめて反映する
+    QList<StatResult> statResults;
+    statResults.swap(m_pendingStatResults);
+    for(const StatResult& statResult : statResults)
+    {
+        applyStatResult(statResult.entries, statResult.entryTable);
+    }
+
+    QHash<QString, qint64> folderSizes;
+    folderSizes.swap(m_pendingFolderSizes);
+    for(QHash<QString, qint64>::const_iterator it = folderSizes.constBegin();it != folderSizes.constEnd();++it)
+    {
+        onFolderSizeCalculated(it.key(), it.value());
+    }
+}
+
+// 新しく列挙したテーブルに置き換え、名前で対応付けて差分を反映する
+void FolderModel::updateEntryTable(const FolderEntryTable& newEntryTable)
+{
+    finishBackgroundSort();
+
+    QVector<int> entryMap(m_entryTable.count(), -1);
+    QVector<bool> changedList(newEntryTable.count(), false);
+    for(int entry = 0;entry < m_entryTable.count();entry++)
+    {
+        int newEntry = newEntryTable.indexOf(m_entryTable.fileName(entry));
+        if(newEntry >= 0 && m_entryTable.isAttributeChanged(entry, newEntryTable, newEntry))
         {
-            return l_type < r_type;
+            changedList[newEntry] = true;
         }
+        entryMap[entry] = newEntry;
     }
-    else if(sectionType == SectionType::LastModified)
+
+    // 属性が変わっていないエントリの表示文字列は引き継ぐ
+    // (どちらかのテーブルで取得していない属性は比較できないので、その列は整形し直す。
+    //  キャッシュから読み込んだ一覧や m_lazyStat で後から取得した属性など)
+    int comparedStatFields = m_entryTable.statFields() & newEntryTable.statFields();
+    for(int column = 0;column < m_displayTextCache.count();column++)
     {
-        if(sectionType2nd != SectionType::Unknown && l_info.lastModified() == r_info.lastModified())
+        if(statFieldOf(m_sectionTypeList.value(column)) & ~comparedStatFields)
         {
-            return sectionTypeLessThan(l_info, r_info, sectionType2nd, SectionType::Unknown, caseSensitivity);
+            m_displayTextCache[column].clear();
+            continue;
         }
-        else
+
+        const QVector<QString>& columnCache = m_displayTextCache[column];
+        QVector<QString> newColumnCache(newEntryTable.count());
+        for(int entry = 0;entry < columnCache.count();entry++)
         {
-            return l_info.lastModified() < r_info.lastModified();
+            int newEntry = entryMap[entry];
+            if(newEntry >= 0 && !changedList[newEntry])
+            {
+                newColumnCache[newEntry] = columnCache[entry];
+            }
         }
+        m_displayTextCache[column] = newColumnCache;
     }
-    else
+
+    // 削除されたエントリの行は、行の削除を通知するまで -1 になる
+    m_entryTable = newEntryTable;
+    clearSortKeys();
+    clearStats();
+    updateColorRoles();
+    updateFolderSizes();
+    for(int row = 0;row < m_rowList.count();row++)
     {
-        QString l_name = (!l_info.isDir() && !l_info.completeBaseName().isEmpty()) ? l_info.completeBaseName() : l_info.fileName();
-        QString r_name = (!r_info.isDir() && !r_info.completeBaseName().isEmpty()) ? r_info.completeBaseName() : r_info.fileName();
+        m_rowList[row] = entryMap[m_rowList[row]];
+    }
 
-        if(caseSensitivity == SortCaseSensitivity::Insensitive)
-        {
-            l_name = l_name.toLower();
-            r_name = r_name.toLower();
-        }
+    sortEntryOrder();
+
+    updateRowList(filterEntries(m_entryOrder), changedList);
+    scheduleListingCacheSave();
 
-        if(sectionType2nd != SectionType::Unknown && l_name == r_name)
+    if(m_lazyStat)
+    {
+        // 後から取得した属性は読み直したので、表示中の行の属性の列を取得し直させる
+        int firstColumn = columnCount();
+        int lastColumn = -1;
+        for(int column = 0;column < columnCount();column++)
         {
-            return sectionTypeLessThan(l_info, r_info, sectionType2nd, SectionType::Unknown, caseSensitivity);
+            if(statFieldOf(m_sectionTypeList[column]) & ~m_entryTable.statFields())
+            {
+                firstColumn = qMin(firstColumn, column);
+                lastColumn = qMax(lastColumn, column);
+            }
         }
-        else
+
+        int firstRow = qBound(0, m_visibleFirstRow, m_rowList.count());
+        int lastRow = qMin(m_visibleFirstRow + m_visibleRowCount, m_rowList.count()) - 1;
+        if(lastColumn >= 0 && firstRow <= lastRow)
         {
-            return l_name < r_name;
+            emit dataChanged(index(firstRow, firstColumn), index(lastRow, lastColumn));
         }
     }
 
-    return false;
+    if(m_statisticsEnabled)
+    {
+        logStatistics("update");
+    }
 }
 
-/// Filter
-
-void FolderModel::setFilterFlags(FilterFlags filterFlags)
+// 並び替え済みの新しい行との差分を、行の削除・追加・更新として反映する
+void FolderModel::updateRowList(const QVector<int>& newRowList, const QVector<bool>& changedList/* = QVector<bool>()*/)
 {
-    m_filterFlags = filterFlags;
+    finishBackgroundSort();
+
+    QVector<int> newRowOfEntry(m_entryTable.count(), -1);
+    for(int newRow = 0;newRow < newRowList.count();newRow++)
+    {
+        newRowOfEntry[newRowList[newRow]] = newRow;
+    }
+
+    // 新しい行に無い行と、並び順が前後した行を削除対象にする
+    // (残す行は、新しい行番号が増加する最長の部分列を patience sorting で求める : O(n log n))
+    auto newRowOf = [this, &newRowOfEntry](int row)
+    {
+        return (m_rowList[row] >= 0) ? newRowOfEntry[m_rowList[row]] : -1;
+    };
+
+    QVector<int> tailRows;                          // [i] = 長さ i + 1 の部分列のうち、末尾の新しい行番号が最小のものの末尾の行
+    QVector<int> prevRows(m_rowList.count(), -1);   // 部分列で 1 つ前の行
+    for(int row = 0;row < m_rowList.count();row++)
+    {
+        int newRow = newRowOf(row);
+        if(newRow < 0)
+        {
+            continue;
+        }
+
+        int length = static_cast<int>(std::lower_bound(tailRows.data(), tailRows.data() + tailRows.count(), newRow,
+                                                       [&newRowOf](int tailRow, int value){ return newRowOf(tailRow) < value; }) - tailRows.data());
+        if(length > 0)
+        {
+            prevRows[row] = tailRows[length - 1];
+        }
+        if(length == tailRows.count())
+        {
+            tailRows.push_back(row);
+        }
+        else
+        {
+            tailRows[length] = row;
+        }
+    }
+
+    QVector<bool> keepList(m_rowList.count(), false);
+    QVector<bool> newKeepList(newRowList.count(), false);
+    for(int row = (tailRows.isEmpty()) ? -1 : tailRows.last();row >= 0;row = prevRows[row])
+    {
+        keepList[row] = true;
+        newKeepList[newRowOf(row)] = true;
+    }
+
+    // 飛び飛びの変更が多い場合は、行単位で通知するよりリセットした方が速い
+    int rangeNum = 0;
+    for(int row = 0;row < keepList.count();row++)
+    {
+        if(!keepList[row] && (row == 0 || keepList[row - 1]))
+        {
+            rangeNum++;
+        }
+    }
+    for(int newRow = 0;newRow < newKeepList.count();newRow++)
+    {
+        if(!newKeepList[newRow] && (newRow == 0 || newKeepList[newRow - 1]))
+        {
+            rangeNum++;
+        }
+    }
+
+    if(rangeNum > 100)
+    {
+        resetRowList(newRowList);
+
+        return;
+    }
+
+    for(int last = m_rowList.count() - 1;last >= 0;)
+    {
+        if(keepList[last])
+        {
+            last--;
+            continue;
+        }
+
+        int first = last;
+        while(first > 0 && !keepList[first - 1])
+        {
+            first--;
+        }
+
+        beginRemoveRows(QModelIndex(), first, last);
+        m_rowList.remove(first, last - first + 1);
+        endRemoveRows();
+
+        last = first - 1;
+    }
+
+    // 残った行は新しい行の部分列なので、先頭から突き合わせて隙間に追加する
+    QVector<int> changedRows;
+    int row = 0;
+    while(row < newRowList.count())
+    {
+        if(row < m_rowList.count() && m_rowList[row] == newRowList[row])
+        {
+            if(!changedList.isEmpty() && changedList[m_rowList[row]])
+            {
+                changedRows.push_back(row);
+            }
+            row++;
+
+            continue;
+        }
+
+        int last = (row < m_rowList.count()) ? newRowOfEntry[m_rowList[row]] - 1 : newRowList.count() - 1;
+
+        beginInsertRows(QModelIndex(), row, last);
+        m_rowList = m_rowList.mid(0, row) + newRowList.mid(row, last - row + 1) + m_rowList.mid(row);
+        endInsertRows();
+
+        row = last + 1;
+    }
+
+    // 削除・更新されたエントリの属性は残っていないので、差分適用後に数え直す
+    updateEntryRows();
+    recount();
+
+    for(int i = 0;i < changedRows.count();)
+    {
+        int first = changedRows[i];
+        int last = first;
+        while(++i < changedRows.count() && changedRows[i] == last + 1)
+        {
+            last++;
+        }
+
+        emit dataChanged(createIndex(first, 0), createIndex(last, columnCount() - 1));
+    }
+}
+
+/// Loading
+
+void FolderModel::setAsyncLoading(bool asyncLoading)
+{
+    m_asyncLoading = asyncLoading;
+}
+
+bool FolderModel::asyncLoading() const
+{
+    return m_asyncLoading;
+}
+
+bool FolderModel::isLoading() const
+{
+    return m_scanner != Q_NULLPTR && !m_scanUpdating;
+}
+
+void FolderModel::setRecursiveListing(bool recursiveListing)
+{
+    m_recursiveListing = recursiveListing;
+}
+
+bool FolderModel::recursiveListing() const
+{
+    return m_recursiveListing;
+}
+
+void FolderModel::setRecursiveMaxDepth(int maxDepth)
+{
+    m_recursiveMaxDepth = maxDepth;
+}
+
+int FolderModel::recursiveMaxDepth() const
+{
+    return m_recursiveMaxDepth;
+}
+
+void FolderModel::setIncrementalFetch(bool incrementalFetch)
+{
+    m_incrementalFetch = incrementalFetch;
+}
+
+bool FolderModel::incrementalFetch() const
+{
+    return m_incrementalFetch;
+}
+
+void FolderModel::setFetchBatchSize(int batchSize)
+{
+    m_fetchBatchSize = qMax(1, batchSize);
+}
+
+int FolderModel::fetchBatchSize() const
+{
+    return m_fetchBatchSize;
+}
+
+void FolderModel::setLazyStat(bool lazyStat)
+{
+    m_lazyStat = lazyStat;
+}
+
+bool FolderModel::lazyStat() const
+{
+    return m_lazyStat;
+}
+
+void FolderModel::onStatRequestTimerTimeout()
+{
+    if(!m_lazyStat || m_rowList.isEmpty())
+    {
+        return;
+    }
+
+    // data() で要求された行に、表示範囲の前後 1 画面分を先読みとして加える
+    QVector<int> rows;
+    for(QSet<int>::iterator it = m_requestedStatEntries.begin();it != m_requestedStatEntries.end();)
+    {
+        int row = m_entryRows.value(*it, -1);
+        if(row < 0)
+        {
+            // フィルタで表示しなくなった行は、再び表示された時に要求し直す
+            it = m_requestedStatEntries.erase(it);
+            continue;
+        }
+
+        rows.push_back(row);
+        ++it;
+    }
+
+    int firstRow = qMax(0, m_visibleFirstRow - m_visibleRowCount);
+    int lastRow = qMin(m_rowList.count(), m_visibleFirstRow + m_visibleRowCount * 2);
+    for(int row = firstRow;row < lastRow;row++)
+    {
+        int entry = m_rowList[row];
+        if(!isStatLoaded(entry, FolderEntryTable::AllStatFields) && !m_requestedStatEntries.contains(entry))
+        {
+            m_requestedStatEntries.insert(entry);
+            rows.push_back(row);
+        }
+    }
+
+    // 表示範囲の中央に近い行から順に stat する
+    int centerRow = m_visibleFirstRow + m_visibleRowCount / 2;
+    std::sort(rows.begin(), rows.end(), [centerRow](int l, int r)
+    {
+        return qAbs(l - centerRow) < qAbs(r - centerRow);
+    });
+
+    QVector<int> entries;
+    QStringList filePaths;
+    entries.reserve(rows.count());
+    foreach(int row, rows)
+    {
+        entries.push_back(m_rowList[row]);
+        filePaths.push_back(m_dir.filePath(m_entryTable.fileName(m_rowList[row])));
+    }
+
+    m_statLoader->setRequests(m_statRequestId, FolderEntryTable::AllStatFields & ~m_entryTable.statFields(), entries, filePaths);
+}
+
+void FolderModel::onStatLoaded(int requestId, const QVector<int>& entries, const FolderEntryTable& entryTable)
+{
+    if(requestId != m_statRequestId)
+    {
+        // エントリを読み直す前の要求
+        return;
+    }
+
+    if(m_backgroundSorting)
+    {
+        // テーブルはバックグラウンドのソートが参照しているので、ソートが終わってから反映する
+        m_pendingStatResults.append({entries, entryTable});
+        return;
+    }
+
+    applyStatResult(entries, entryTable);
+}
+
+void FolderModel::applyStatResult(const QVector<int>& entries, const FolderEntryTable& entryTable)
+{
+    int statFields = FolderEntryTable::AllStatFields & ~m_entryTable.statFields();
+
+    m_statLoaded.resize(m_entryTable.count());
+
+    int firstRow = m_rowList.count();
+    int lastRow = -1;
+    for(int i = 0;i < entries.count();i++)
+    {
+        int entry = entries[i];
+        if(entry >= m_entryTable.count())
+        {
+            continue;
+        }
+
+        // フィルタで表示しなくなり要求から外した行も、m_statLoader は同じ要求の間 stat し直さないので反映しておく
+        m_requestedStatEntries.remove(entry);
+
+        m_entryTable.setAttributes(entry, entryTable, i, statFields);
+        m_statLoaded[entry] = true;
+
+        for(int column = 0;column < m_displayTextCache.count();column++)
+        {
+            if(entry < m_displayTextCache[column].count())
+            {
+                m_displayTextCache[column][entry] = QString();
+            }
+        }
+        if(entry < m_colorRoles.count())
+        {
+            m_colorRoles[entry] = static_cast<quint8>(classifyColorRole(entry));
+        }
+
+        int row = m_entryRows.value(entry, -1);
+        if(row >= 0)
+        {
+            firstRow = qMin(firstRow, row);
+            lastRow = qMax(lastRow, row);
+        }
+    }
+
+    if(lastRow >= 0)
+    {
+        emit dataChanged(index(firstRow, 0), index(lastRow, columnCount() - 1));
+    }
+}
+
+void FolderModel::setListingCacheEnabled(bool enabled)
+{
+    m_listingCacheEnabled = enabled;
+}
+
+bool FolderModel::listingCacheEnabled() const
+{
+    return m_listingCacheEnabled;
+}
+
+void FolderModel::setListingCacheDir(const QString& cacheDir)
+{
+    m_listingCache.setCacheDir(cacheDir);
+}
+
+QString FolderModel::listingCacheDir() const
+{
+    return m_listingCache.cacheDir();
+}
+
+// 再帰表示・検索結果は 1 つのディレクトリの一覧ではないので保存しない
+bool FolderModel::isListingCacheUsable() const
+{
+    return m_listingCacheEnabled && !m_recursiveListing && !m_searchResult;
+}
+
+void FolderModel::saveListingCache()
+{
+    m_listingCacheSaveTimer.stop();
+
+    if(!isListingCacheUsable())
+    {
+        return;
+    }
+
+    FolderListingCache listingCache = m_listingCache;
+    QString path = m_dir.absolutePath();
+    FolderEntryTable entryTable = m_entryTable;
+
+    // 書き込みは GUI スレッドで待たない
+    QtConcurrent::run([listingCache, path, entryTable]()
+    {
+        listingCache.save(path, entryTable);
+    });
+}
+
+void FolderModel::scheduleListingCacheSave()
+{
+    if(isListingCacheUsable() && !m_listingCacheSaveTimer.isActive())
+    {
+        m_listingCacheSaveTimer.start();
+    }
+}
+
+// 保存を待っている差分があれば書き出す(フォルダを移動する前・破棄する前)
+void FolderModel::flushListingCache()
+{
+    if(m_listingCacheSaveTimer.isActive())
+    {
+        saveListingCache();
+    }
+}
+
+void FolderModel::onListingCacheSaveTimerTimeout()
+{
+    saveListingCache();
+}
+
+void FolderModel::setAutoUpdate(bool autoUpdate)
+{
+    m_autoUpdate = autoUpdate;
+
+    updateWatchPath();
+}
+
+bool FolderModel::autoUpdate() const
+{
+    return m_autoUpdate;
+}
+
+void FolderModel::setAutoUpdateInterval(int msec)
+{
+    m_updateTimer.setInterval(msec);
+}
+
+int FolderModel::autoUpdateInterval() const
+{
+    return m_updateTimer.interval();
+}
+
+void FolderModel::updateWatchPath()
+{
+    QStringList watchedDirs = m_fileSystemWatcher.directories();
+    if(!watchedDirs.isEmpty())
+    {
+        m_fileSystemWatcher.removePaths(watchedDirs);
+    }
+
+    m_updateTimer.stop();
+
+    if(m_autoUpdate && !m_rootPath.isEmpty())
+    {
+        m_fileSystemWatcher.addPath(m_rootPath);
+    }
+}
+
+void FolderModel::onDirectoryChanged(const QString& path)
+{
+    Q_UNUSED(path);
+
+    // 変更が続いている間も一定間隔で反映されるよう、タイマーは再始動しない
+    if(!m_updateTimer.isActive())
+    {
+        m_updateTimer.start();
+    }
+}
+
+void FolderModel::onUpdateTimerTimeout()
+{
+    updateEntries();
+}
+
+// 選択状態を保ったまま、表示中の行を丸ごと置き換える
+void FolderModel::resetRowList(const QVector<int>& newRowList)
+{
+    finishBackgroundSort();
+
+    QVector<bool> selectedList(m_entryTable.count(), false);
+    bool selected = false;
+    foreach(const QModelIndex& index, m_itemSelectionModel.selectedRows())
+    {
+        int entry = entryIndex(index);
+        if(entry >= 0)
+        {
+            selectedList[entry] = true;
+            selected = true;
+        }
+    }
+
+    beginResetModel();
+    m_rowList = newRowList;
+    updateEntryRows();
+    recount();
+    endResetModel();
+
+    if(!selected)
+    {
+        return;
+    }
+
+    QItemSelection selection;
+    for(int row = 0;row < m_rowList.count();row++)
+    {
+        if(!selectedList[m_rowList[row]])
+        {
+            continue;
+        }
+
+        int first = row;
+        while(row + 1 < m_rowList.count() && selectedList[m_rowList[row + 1]])
+        {
+            row++;
+        }
+
+        selection.select(createIndex(first, 0), createIndex(row, columnCount() - 1));
+    }
+
+    m_itemSelectionModel.select(selection, QItemSelectionModel::Select);
+}
+
+void FolderModel::updateEntries()
+{
+    if(m_searchResult)
+    {
+        // 検索結果は検索した時点のものを表示し続ける
+        return;
+    }
+
+    if(m_scanner != Q_NULLPTR)
+    {
+        if(m_scanUpdating)
+        {
+            // 前回の差分取得が終わっていないので、後でもう一度確認する
+            m_updateTimer.start();
+
+            return;
+        }
+
+        if(!canFetchMore(QModelIndex()))
+        {
+            // 既に受け取ったエントリの削除・変更は読み込みの結果に含まれないので、読み込み後に確認する
+            m_updatePending = true;
+
+            return;
+        }
+
+        // 要求待ちで止まっている読み込みは終わらないので、打ち切って全体の差分を確認する
+        startScan(true);
+
+        return;
+    }
+
+    if(m_asyncLoading || m_recursiveListing)
+    {
+        startScan(true);
+
+        return;
+    }
+
+    FolderEntryTable entryTable;
+    if(readEntryTable(entryTable) < 0)
+    {
+        return;
+    }
+
+    updateEntryTable(entryTable);
+}
+
+int FolderModel::readEntryTable(FolderEntryTable& entryTable)
+{
+    QElapsedTimer timer;
+    if(m_statisticsEnabled)
+    {
+        timer.start();
+    }
+
+    int ret = readEntryTableFromDir(entryTable);
+
+    if(m_statisticsEnabled && ret == 0)
+    {
+        m_statistics.enumerateTime += timer.nsecsElapsed();
+        m_statistics.scannedNum += entryTable.count();
+    }
+
+    return ret;
+}
+
+int FolderModel::readEntryTableFromDir(FolderEntryTable& entryTable)
+{
+#ifdef Q_OS_LINUX
+    if(Linux::readFolderEntries(m_dir.path(), requiredStatFields(), entryTable) == 0 && !entryTable.isEmpty())
+    {
+        return 0;
+    }
+#endif
+
+    m_dir.refresh();            // QDir は一覧をキャッシュしているので読み直させる
+
+    QFileInfoList fileInfoList = m_dir.entryInfoList();
+    if(fileInfoList.isEmpty())
+    {
+        return -1;
+    }
+
+    entryTable.clear();
+    entryTable.append(fileInfoList);
+
+    return 0;
+}
+
+// 表示する列・ソートキー・文字色で使用する属性のみ stat する
+int FolderModel::requiredStatFields() const
+{
+    // m_lazyStat の場合、表示のみに使う属性は表示する行の分だけ後から取得する
+    QList<SectionType> sectionTypeList = (m_lazyStat) ? QList<SectionType>() : m_sectionTypeList;
+    foreach(const SortKey& sortKey, m_sortKeys)
+    {
+        sectionTypeList << sortKey.sectionType;
+    }
+
+    int statFields = FolderEntryTable::NoStatField;
+    foreach(SectionType sectionType, sectionTypeList)
+    {
+        statFields |= statFieldOf(sectionType);
+    }
+
+    if(!m_lazyStat &&
+       (brush(ColorRoleType::ReadOnly).style() != Qt::NoBrush || brush(ColorRoleType::ReadOnly_Selected).style() != Qt::NoBrush))
+    {
+        statFields |= FolderEntryTable::ModeField;
+    }
+
+    return statFields;
+}
+
+int FolderModel::statFieldOf(SectionType sectionType)
+{
+    switch(sectionType)
+    {
+    case SectionType::FileSize:
+        return FolderEntryTable::SizeField;
+    case SectionType::Owner:
+    case SectionType::Group:
+        return FolderEntryTable::OwnerField;
+    case SectionType::Permissions:
+        return FolderEntryTable::ModeField;
+    case SectionType::Created:
+    case SectionType::LastModified:
+        return FolderEntryTable::TimeField;
+    default:
+        break;
+    }
+
+    return FolderEntryTable::NoStatField;
+}
+
+// 列挙時に取得したか、m_statLoader で取得済みか
+bool FolderModel::isStatLoaded(int entry, int statFields) const
+{
+    if((m_entryTable.statFields() & statFields) == statFields)
+    {
+        return true;
+    }
+
+    return entry < m_statLoaded.count() && m_statLoaded[entry];
+}
+
+void FolderModel::requestStat(int entry) const
+{
+    if(m_requestedStatEntries.contains(entry))
+    {
+        return;
+    }
+
+    m_requestedStatEntries.insert(entry);
+
+    if(!m_statRequestTimer.isActive())
+    {
+        m_statRequestTimer.start();
+    }
+}
+
+void FolderModel::clearStats()
+{
+    // 結果を受け取る前の要求はエントリの番号が変わるので捨てる
+    m_statRequestId++;
+    m_statLoaded.clear();
+    m_requestedStatEntries.clear();
+    m_pendingStatResults.clear();
+    m_statLoader->clearRequests();
+}
+
+int FolderModel::startScan(bool update/* = false*/)
+{
+    cancelScan();
+
+    finishBackgroundSort();
+
+    if(!update)
+    {
+        beginResetModel();
+        m_rowList.clear();
+        m_entryRows.clear();
+        m_counts = FolderCounts();
+        m_entryTable.clear();
+        clearSortKeys();
+        clearStats();
+        m_displayTextCache.clear();
+        m_colorRoles.clear();
+        m_folderSizes.clear();
+        m_entryOrder.clear();
+        m_entryOrderSorted = false;
+        endResetModel();
+    }
+
+    m_scanId++;
+    m_loadedNum = 0;
+    m_scanUpdating = update;
+    m_updatePending = false;
+    m_pendingEntryTable.clear();
+    m_fetchLimit = -1;
+
+    m_scanner = createScanner();
+
+    connect(m_scanner, SIGNAL(entriesFound(int,FolderEntryTable)), this, SLOT(onScannerEntriesFound(int,FolderEntryTable)));
+    connect(m_scanner, SIGNAL(scanFinished(int,int)), this, SLOT(onScannerFinished(int,int)));
+    connect(m_scanner, SIGNAL(finished()), m_scanner, SLOT(deleteLater()));
+
+    m_scanner->start();
+
+    return 0;
+}
+
+FolderScanner* FolderModel::createScanner()
+{
+    m_scannedSkipTypeFlags = 0;
+
+    if(m_searchResult)
+    {
+        m_scannedSkipTypeFlags = scanSkipTypeFlags();
+
+        FolderSearcher* searcher = new FolderSearcher(m_scanId, m_dir);
+        searcher->setMaxDepth(m_searchCondition.maxDepth);
+        searcher->setStatFields(requiredStatFields());
+        searcher->setSkipTypeFlags(m_scannedSkipTypeFlags);
+        searcher->setNameRegExp(m_searchNameRegExp);
+        searcher->setContentText(m_searchCondition.contentText, m_searchCondition.caseSensitivity);
+
+        connect(searcher, SIGNAL(searchProgress(int,FolderSearchStatistics)), this, SLOT(onSearcherProgress(int,FolderSearchStatistics)));
+
+        return searcher;
+    }
+
+    if(m_recursiveListing)
+    {
+        FolderTreeScanner* treeScanner = new FolderTreeScanner(m_scanId, m_dir);
+        treeScanner->setMaxDepth(m_recursiveMaxDepth);
+        treeScanner->setStatFields(requiredStatFields());
+
+        m_scannedSkipTypeFlags = scanSkipTypeFlags();
+        treeScanner->setSkipTypeFlags(m_scannedSkipTypeFlags);
+
+        return treeScanner;
+    }
+
+    FolderScanner* scanner = new FolderScanner(m_scanId, m_dir);
+    if(m_lazyStat)
+    {
+        scanner->setStatFields(requiredStatFields());
+    }
+
+    // 差分の確認では全てのエントリが必要なので、上限は初回の読み込みにのみ設ける
+    if(m_incrementalFetch && !m_scanUpdating)
+    {
+        m_fetchLimit = m_fetchBatchSize;
+        scanner->setFetchLimit(m_fetchLimit);
+        scanner->setBatchSize(m_fetchBatchSize);
+    }
+
+    return scanner;
+}
+
+// 除外するエントリの中身を読まないように、サブディレクトリを辿る列挙ではフィルタを列挙の時点で適用する
+int FolderModel::scanSkipTypeFlags() const
+{
+    int skipTypeFlags = 0;
+    if(!(m_filterFlags & FilterFlag::Hidden))
+    {
+        skipTypeFlags |= FolderEntryTable::Hidden;
+    }
+    if(!(m_filterFlags & FilterFlag::System))
+    {
+        skipTypeFlags |= FolderEntryTable::System;
+    }
+
+    return skipTypeFlags;
+}
+
+void FolderModel::cancelScan()
+{
+    if(m_scanner != Q_NULLPTR)
+    {
+        // 古いスキャンの結果は受け取らない(スレッドは終了後に自身で deleteLater される)
+        m_scanner->disconnect(this);
+        m_scanner->cancel();
+        m_scanner = Q_NULLPTR;
+    }
+}
+
+void FolderModel::onScannerEntriesFound(int scanId, const FolderEntryTable& entryTable)
+{
+    if(scanId != m_scanId)
+    {
+        return;
+    }
+
+    m_loadedNum += entryTable.count();
+    if(m_statisticsEnabled)
+    {
+        m_statistics.scannedNum += entryTable.count();
+    }
+
+    if(m_scanUpdating)
+    {
+        m_pendingEntryTable.append(entryTable);
+
+        return;
+    }
+
+    finishBackgroundSort();
+
+    int firstEntry = m_entryTable.count();
+    m_entryTable.append(entryTable);
+    m_entryOrderSorted = false;
+
+    m_entryRows.resize(firstEntry);
+    m_entryRows.insert(firstEntry, entryTable.count(), -1);
+    updateColorRoles(firstEntry);
+    updateFolderSizes(firstEntry);
+
+    QVector<int> acceptedList;
+    for(int entry = firstEntry;entry < m_entryTable.count();entry++)
+    {
+        if(isAcceptedEntry(entry))
+        {
+            acceptedList.push_back(entry);
+        }
+    }
+
+    if(!acceptedList.isEmpty())
+    {
+        int first = m_rowList.count();
+
+        beginInsertRows(QModelIndex(), first, first + acceptedList.count() - 1);
+        m_rowList += acceptedList;
+        for(int row = first;row < m_rowList.count();row++)
+        {
+            m_entryRows[m_rowList[row]] = row;
+            addCounts(m_rowList[row]);
+        }
+        endInsertRows();
+
+        // 要求した分が揃ったら、それまでに読み込んだ行を並べ替えておく
+        if(canFetchMore(QModelIndex()))
+        {
+            sortRowList();
+        }
+    }
+    else if(canFetchMore(QModelIndex()))
+    {
+        // 全てフィルタで除外された場合は行が増えずビューから要求されないので、続けて読む
+        fetchMore(QModelIndex());
+    }
+
+    emit loadingProgress(m_loadedNum);
+}
+
+void FolderModel::onScannerFinished(int scanId, int result)
+{
+    if(scanId != m_scanId)
+    {
+        return;
+    }
+
+    m_scanner = Q_NULLPTR;
+    m_fetchLimit = -1;
+
+    if(m_scanUpdating)
+    {
+        m_scanUpdating = false;
+
+        if(result == 0)
+        {
+            FolderEntryTable newEntryTable = m_pendingEntryTable;
+            m_pendingEntryTable.clear();
+
+            updateEntryTable(newEntryTable);
+        }
+
+        return;
+    }
+
+    if(result < 0)
+    {
+        qDebug() << "Entry list is Empty.";
+    }
+    else
+    {
+        // バッチは列挙順に追加しているので、最後にまとめて並び替える
+        sortRowList();
+        saveListingCache();
+    }
+
+    if(m_statisticsEnabled)
+    {
+        logStatistics("load");
+    }
+
+    emit loadingFinished(result);
+
+    if(m_searchResult)
+    {
+        emit searchFinished(result);
+    }
+
+    if(m_updatePending)
+    {
+        m_updatePending = false;
+
+        updateEntries();
+    }
+}
+
+void FolderModel::onSearcherProgress(int scanId, const FolderSearchStatistics& statistics)
+{
+    if(scanId != m_scanId)
+    {
+        return;
+    }
+
+    m_searchStatistics = statistics;
+
+    emit searchProgress(statistics);
+}
+
+bool FolderModel::lessThan(int l_entry, int r_entry) const
+{
+    if(m_sortDotFirst)
+    {
+        bool l_dotDot = m_entryTable.isDotDot(l_entry);
+        bool r_dotDot = m_entryTable.isDotDot(r_entry);
+        if(l_dotDot != r_dotDot)
+        {
+            return l_dotDot;
+        }
+    }
+
+    if(m_sortDirsType != SortDirsType::NoSpecify)
+    {
+        bool l_dir = m_entryTable.isDir(l_entry);
+        bool r_dir = m_entryTable.isDir(r_entry);
+        if(l_dir != r_dir)
+        {
+            return (m_sortDirsType == SortDirsType::First) ? l_dir : r_dir;
+        }
+    }
+
+    // キーの種類ごとの分岐は compileSortKeys() で済ませてあるので、ここではキーの数だけ呼び出す
+    foreach(const CompiledSortKey& sortKey, m_compiledSortKeys)
+    {
+        int result = (this->*sortKey.compare)(l_entry, r_entry);
+        if(result != 0)
+        {
+            return (sortKey.descending) ? result > 0 : result < 0;
+        }
+    }
+
+    // 同順位の場合はファイル名で順序を確定させる(差分更新時に行が入れ替わらないように)
+    // 方向は 1 番目のキーに合わせる
+    bool descending = (!m_compiledSortKeys.isEmpty() && m_compiledSortKeys.first().descending);
+
+    int result = FolderEntryTable::compareString(m_entryTable.nameData(l_entry, false), m_entryTable.nameLength(l_entry, false),
+                                                 m_entryTable.nameData(r_entry, false), m_entryTable.nameLength(r_entry, false));
+
+    return (descending) ? result > 0 : result < 0;
+}
+
+namespace
+{
+
+int compareInteger(qint64 l, qint64 r)
+{
+    return (l < r) ? -1 : (l > r) ? 1 : 0;
+}
+
+}           // namespace
+
+template<>
+int FolderModel::compareKey<SectionType::FileName>(int l_entry, int r_entry) const
+{
+    return compareNameKey(l_entry, r_entry);
+}
+
+template<>
+int FolderModel::compareKey<SectionType::FileType>(int l_entry, int r_entry) const
+{
+    const QChar* l_data;
+    const QChar* r_data;
+    int l_length;
+    int r_length;
+
+    typeKey(l_entry, &l_data, &l_length);
+    typeKey(r_entry, &r_data, &r_length);
+
+    if(l_length == 0 && r_length == 0)
+    {
+        bool folded = (m_sortCaseSensitivity == SortCaseSensitivity::Insensitive);
+
+        l_data = m_entryTable.nameData(l_entry, folded);
+        l_length = m_entryTable.nameLength(l_entry, folded);
+        r_data = m_entryTable.nameData(r_entry, folded);
+        r_length = m_entryTable.nameLength(r_entry, folded);
+    }
+
+    return FolderEntryTable::compareString(l_data, l_length, r_data, r_length);
+}
+
+template<>
+int FolderModel::compareKey<SectionType::FileSize>(int l_entry, int r_entry) const
+{
+    // フォルダは計算済みのサイズ、未計算・計算しない場合は -1 で比較する
+    // (片方の種別だけで同順位にすると推移律が成り立たなくなる)
+    return compareInteger(sizeKey(l_entry), sizeKey(r_entry));
+}
+
+template<>
+int FolderModel::compareKey<SectionType::Owner>(int l_entry, int r_entry) const
+{
+    return m_ownerRanks[l_entry] - m_ownerRanks[r_entry];
+}
+
+template<>
+int FolderModel::compareKey<SectionType::Group>(int l_entry, int r_entry) const
+{
+    return m_groupRanks[l_entry] - m_groupRanks[r_entry];
+}
+
+template<>
+int FolderModel::compareKey<SectionType::Permissions>(int l_entry, int r_entry) const
+{
+    return compareInteger(m_entryTable.permissions(l_entry), m_entryTable.permissions(r_entry));
+}
+
+template<>
+int FolderModel::compareKey<SectionType::Created>(int l_entry, int r_entry) const
+{
+    return compareInteger(m_entryTable.created(l_entry), m_entryTable.created(r_entry));
+}
+
+template<>
+int FolderModel::compareKey<SectionType::LastModified>(int l_entry, int r_entry) const
+{
+    return compareInteger(m_entryTable.lastModified(l_entry), m_entryTable.lastModified(r_entry));
+}
+
+// ソートキーをキーの種類ごとの比較関数の列にする(所有者・グループは名前の順位を整数で持っておく)
+void FolderModel::compileSortKeys() const
+{
+    m_compiledSortKeys.clear();
+
+    foreach(const SortKey& sortKey, m_sortKeys)
+    {
+        KeyCompareFunc compare = Q_NULLPTR;
+
+        switch(sortKey.sectionType)
+        {
+        case SectionType::FileName:
+            compare = &FolderModel::compareKey<SectionType::FileName>;
+            break;
+        case SectionType::FileType:
+            compare = &FolderModel::compareKey<SectionType::FileType>;
+            break;
+        case SectionType::FileSize:
+            compare = &FolderModel::compareKey<SectionType::FileSize>;
+            break;
+        case SectionType::Owner:
+            compare = &FolderModel::compareKey<SectionType::Owner>;
+            updateIdRanks(false, m_ownerRanks);
+            break;
+        case SectionType::Group:
+            compare = &FolderModel::compareKey<SectionType::Group>;
+            updateIdRanks(true, m_groupRanks);
+            break;
+        case SectionType::Permissions:
+            compare = &FolderModel::compareKey<SectionType::Permissions>;
+            break;
+        case SectionType::Created:
+            compare = &FolderModel::compareKey<SectionType::Created>;
+            break;
+        case SectionType::LastModified:
+            compare = &FolderModel::compareKey<SectionType::LastModified>;
+            break;
+        default:
+            break;
+        }
+
+        if(compare != Q_NULLPTR)
+        {
+            m_compiledSortKeys.push_back({compare, sortKey.order == SortOrderType::Descending});
+        }
+    }
+}
+
+// ID ごとの名前を並べた順位をエントリごとに求める(名前の取得・比較は ID の種類数だけで済む)
+void FolderModel::updateIdRanks(bool group, QVector<int>& ranks) const
+{
+    // 名前は ID ごとに 1 度だけ引き、名前の順位をエントリごとの比較キーにする
+    // (Windows では ID が得られない(-2)ので、エントリごとに名前を引く)
+    const uint unknownId = static_cast<uint>(-2);
+
+    QHash<uint, QString> idNames;
+    QVector<QString> entryNames(m_entryTable.count());
+    for(int entry = 0;entry < m_entryTable.count();entry++)
+    {
+        uint id = (group) ? m_entryTable.groupId(entry) : m_entryTable.ownerId(entry);
+        if(id == unknownId)
+        {
+            entryNames[entry] = (group) ? groupName(entry) : ownerName(entry);
+            continue;
+        }
+
+        QHash<uint, QString>::const_iterator itr = idNames.find(id);
+        if(itr == idNames.end())
+        {
+            itr = idNames.insert(id, (group) ? groupName(entry) : ownerName(entry));
+        }
+        entryNames[entry] = *itr;
+    }
+
+    QVector<QString> names = entryNames;
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    QHash<QString, int> nameRanks;
+    for(int rank = 0;rank < names.count();rank++)
+    {
+        nameRanks.insert(names[rank], rank);
+    }
+
+    ranks.resize(m_entryTable.count());
+    for(int entry = 0;entry < m_entryTable.count();entry++)
+    {
+        ranks[entry] = nameRanks.value(entryNames[entry]);
+    }
+}
+
+bool FolderModel::isSortKey(SectionType sectionType) const
+{
+    foreach(const SortKey& sortKey, m_sortKeys)
+    {
+        if(sortKey.sectionType == sectionType)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// 表示名(拡張子を除いた名前)の比較キー
+void FolderModel::nameKey(int entry, const QChar** data, int* length) const
+{
+    bool folded = (m_sortCaseSensitivity == SortCaseSensitivity::Insensitive);
+    int baseNameLength = m_entryTable.baseNameLength(entry, folded);
+
+    *data = m_entryTable.nameData(entry, folded);
+    *length = (!m_entryTable.isDir(entry) && baseNameLength > 0) ? baseNameLength : m_entryTable.nameLength(entry, folded);
+}
+
+// 拡張子の比較キー(拡張子として扱わない場合は長さ 0)
+void FolderModel::typeKey(int entry, const QChar** data, int* length) const
+{
+    bool folded = (m_sortCaseSensitivity == SortCaseSensitivity::Insensitive);
+    int baseNameLength = m_entryTable.baseNameLength(entry, folded);
+    int nameLength = m_entryTable.nameLength(entry, folded);
+
+    *data = m_entryTable.nameData(entry, folded);
+    *length = 0;
+
+    if(!m_entryTable.isDir(entry) && baseNameLength > 0 && baseNameLength < nameLength)
+    {
+        *data += baseNameLength + 1;
+        *length = nameLength - baseNameLength - 1;
+    }
+}
+
+/// Search
+
+int FolderModel::startSearch(const FolderSearchCondition& condition)
+{
+    QRegularExpression nameRegExp;
+    if(!condition.namePattern.isEmpty())
+    {
+        nameRegExp = QRegularExpression(condition.namePattern,
+                                        (condition.caseSensitivity == Qt::CaseInsensitive) ? QRegularExpression::CaseInsensitiveOption :
+                                                                                             QRegularExpression::NoPatternOption);
+        if(!nameRegExp.isValid())
+        {
+            return -1;
+        }
+    }
+    else if(!condition.nameFilters.isEmpty() && !condition.nameFilters.contains("*"))
+    {
+        nameRegExp = makeWildcardRegExp(condition.nameFilters);
+        if(condition.caseSensitivity == Qt::CaseSensitive)
+        {
+            nameRegExp.setPatternOptions(QRegularExpression::NoPatternOption);
+        }
+    }
+
+    m_searchResult = true;
+    m_searchCondition = condition;
+    m_searchNameRegExp = nameRegExp;
+    m_searchStatistics = FolderSearchStatistics();
+
+    return startScan();
+}
+
+void FolderModel::cancelSearch()
+{
+    if(!isSearching())
+    {
+        return;
+    }
+
+    cancelScan();
+
+    // ここまでに見つかった結果は残して並び替える
+    sortRowList();
+
+    emit searchFinished(-1);
+}
+
+bool FolderModel::isSearching() const
+{
+    return m_searchResult && m_scanner != Q_NULLPTR;
+}
+
+bool FolderModel::isSearchResult() const
+{
+    return m_searchResult;
+}
+
+FolderSearchStatistics FolderModel::searchStatistics() const
+{
+    return m_searchStatistics;
+}
+
+int FolderModel::compareNameKey(int l_entry, int r_entry) const
+{
+    if(m_sortLocaleAware)
+    {
+        return m_collationKeys[l_entry].compare(m_collationKeys[r_entry]);
+    }
+
+    if(m_sortNaturalOrder)
+    {
+        return FolderEntryTable::compareString(m_naturalKeyArena.constData() + m_naturalKeyOffsets[l_entry], m_naturalKeyLengths[l_entry],
+                                               m_naturalKeyArena.constData() + m_naturalKeyOffsets[r_entry], m_naturalKeyLengths[r_entry]);
+    }
+
+    const QChar* l_data;
+    const QChar* r_data;
+    int l_length;
+    int r_length;
+
+    nameKey(l_entry, &l_data, &l_length);
+    nameKey(r_entry, &r_data, &r_length);
+
+    return FolderEntryTable::compareString(l_data, l_length, r_data, r_length);
+}
+
+// 追加されたエントリの比較キーを作る(エントリは追加のみなので、作っていない分だけ作る)
+void FolderModel::updateSortKeys() const
+{
+    if(m_sortLocaleAware)
+    {
+        if(static_cast<int>(m_collationKeys.size()) >= m_entryTable.count())
+        {
+            return;
+        }
+
+        QCollator collator(m_locale);
+        collator.setNumericMode(m_sortNaturalOrder);
+        collator.setCaseSensitivity(static_cast<Qt::CaseSensitivity>(m_sortCaseSensitivity));
+
+        m_collationKeys.reserve(m_entryTable.count());
+        for(int entry = static_cast<int>(m_collationKeys.size());entry < m_entryTable.count();entry++)
+        {
+            const QChar* data;
+            int length;
+            nameKey(entry, &data, &length);
+
+            m_collationKeys.push_back(collator.sortKey(QString::fromRawData(data, length)));
+        }
+    }
+    else if(m_sortNaturalOrder)
+    {
+        m_naturalKeyOffsets.reserve(m_entryTable.count());
+        m_naturalKeyLengths.reserve(m_entryTable.count());
+        for(int entry = m_naturalKeyOffsets.count();entry < m_entryTable.count();entry++)
+        {
+            const QChar* data;
+            int length;
+            nameKey(entry, &data, &length);
+
+            int offset = m_naturalKeyArena.size();
+            appendNaturalKey(data, length, m_naturalKeyArena);
+
+            m_naturalKeyOffsets.push_back(offset);
+            m_naturalKeyLengths.push_back(m_naturalKeyArena.size() - offset);
+        }
+    }
+}
+
+void FolderModel::clearSortKeys()
+{
+    m_naturalKeyArena.clear();
+    m_naturalKeyOffsets.clear();
+    m_naturalKeyLengths.clear();
+    m_collationKeys.clear();
+}
+
+// 数字の並びを '0'・桁数(先頭の 0 を除く)・数字 に置き換え、コード単位の比較で数値順になるようにする
+// ex. "file2" -> "file" '0' 1 "2", "file10" -> "file" '0' 2 "10"
+void FolderModel::appendNaturalKey(const QChar* data, int length, QString& arena)
+{
+    for(int i = 0;i < length;)
+    {
+        if(!data[i].isDigit())
+        {
+            arena += data[i++];
+            continue;
+        }
+
+        int first = i;
+        while(i < length && data[i].isDigit())
+        {
+            i++;
+        }
+
+        int nonZero = first;
+        while(nonZero < i - 1 && data[nonZero] == '0')
+        {
+            nonZero++;
+        }
+
+        arena += QChar('0');
+        arena += QChar(static_cast<ushort>(i - nonZero));
+        arena += QString::fromRawData(data + nonZero, i - nonZero);
+    }
+}
+
+/// Folder size
+
+void FolderModel::setFolderSizeEnabled(bool enabled)
+{
+    if(m_folderSizeEnabled == enabled)
+    {
+        return;
+    }
+
+    finishBackgroundSort();
+
+    m_folderSizeEnabled = enabled;
+
+    if(!enabled)
+    {
+        m_folderSizeCalculator->cancel();
+    }
+
+    updateFolderSizes();
+    clearDisplayTexts();
+
+    // 全て計算済みであれば allCalculated() は通知されないので、ここで並び替える
+    if(!m_folderSizeCalculator->isCalculating())
+    {
+        onAllFolderSizesCalculated();
+    }
+}
+
+bool FolderModel::folderSizeEnabled() const
+{
+    return m_folderSizeEnabled;
+}
+
+bool FolderModel::isFolderSizeCalculating() const
+{
+    return m_folderSizeCalculator->isCalculating();
+}
+
+// フォルダのサイズを計算済みの値で埋め、未計算のものは計算を要求する
+void FolderModel::updateFolderSizes(int firstEntry/* = 0*/)
+{
+    finishBackgroundSort();
+
+    if(!m_folderSizeEnabled)
+    {
+        m_folderSizes.clear();
+
+        return;
+    }
+
+    m_folderSizes.resize(m_entryTable.count());
+
+    bool timeLoaded = (m_entryTable.statFields() & FolderEntryTable::TimeField);
+
+    for(int entry = firstEntry;entry < m_entryTable.count();entry++)
+    {
+        m_folderSizes[entry] = -1;
+
+        // シンボリックリンクは辿った先で計上されるので、二重に数えないように除外する
+        int typeFlags = m_entryTable.typeFlags(entry);
+        if(!(typeFlags & FolderEntryTable::Dir) || (typeFlags & (FolderEntryTable::DotDot | FolderEntryTable::SymLink)))
+        {
+            continue;
+        }
+
+        QString path = m_dir.absoluteFilePath(m_entryTable.fileName(entry));
+        qint64 lastModified = (timeLoaded) ? m_entryTable.lastModified(entry) :
+                                             QFileInfo(path).lastModified().toMSecsSinceEpoch() * 1000000;
+
+        if(!m_folderSizeCalculator->cachedSize(path, lastModified, &m_folderSizes[entry]))
+        {
+            m_folderSizeCalculator->requestSize(path, lastModified);
+        }
+    }
+}
+
+// サイズでソートする際の値(フォルダは計算したサイズ、未計算の場合は -1)
+qint64 FolderModel::sizeKey(int entry) const
+{
+    if(m_entryTable.isDir(entry))
+    {
+        return (m_folderSizeEnabled && entry < m_folderSizes.count()) ? m_folderSizes[entry] : -1;
+    }
+
+    return m_entryTable.size(entry);
+}
+
+void FolderModel::onFolderSizeCalculated(const QString& path, qint64 size)
+{
+    if(m_backgroundSorting)
+    {
+        // サイズはバックグラウンドのソートの比較に使うので、ソートが終わってから反映する
+        m_pendingFolderSizes.insert(path, size);
+        return;
+    }
+
+    int entry = m_entryTable.indexOf(m_dir.relativeFilePath(path));
+    if(entry < 0 || entry >= m_folderSizes.count() || !m_entryTable.isDir(entry))
+    {
+        return;
+    }
+
+    m_folderSizes[entry] = size;
+
+    int column = m_sectionTypeList.indexOf(SectionType::FileSize);
+    if(column < 0)
+    {
+        return;
+    }
+
+    if(column < m_displayTextCache.count() && entry < m_displayTextCache[column].count())
+    {
+        m_displayTextCache[column][entry] = QString();
+    }
+
+    int row = m_entryRows.value(entry, -1);
+    if(row >= 0)
+    {
+        emit dataChanged(index(row, column), index(row, column), {Qt::DisplayRole, Qt::EditRole});
+    }
+}
+
+void FolderModel::onAllFolderSizesCalculated()
+{
+    // 途中経過では並び替えず、全て揃ってから 1 度だけ並び替える
+    if(isSortKey(SectionType::FileSize))
+    {
+        resort();
+    }
+}
+
+/// Statistics
+
+void FolderModel::setStatisticsEnabled(bool enabled)
+{
+    m_statisticsEnabled = enabled;
+}
+
+bool FolderModel::statisticsEnabled() const
+{
+    return m_statisticsEnabled;
+}
+
+FolderStatistics FolderModel::statistics() const
+{
+    return m_statistics;
+}
+
+void FolderModel::resetStatistics()
+{
+    m_statistics = FolderStatistics();
+}
+
+void FolderModel::logStatistics(const char* operation) const
+{
+    if(!folderModelLog().isDebugEnabled())
+    {
+        return;
+    }
+
+    qCDebug(folderModelLog).nospace()
+            << operation << " " << m_rootPath << " :"
+            << " enumerate " << m_statistics.enumerateTime / 1000 << "us (" << m_statistics.scannedNum << " entries),"
+            << " filter " << m_statistics.filterTime / 1000 << "us (" << m_statistics.filteredOutNum << " filtered out),"
+            << " sort " << m_statistics.sortTime / 1000 << "us (" << m_statistics.compareNum << " compares),"
+            << " reset " << m_statistics.resetTime / 1000 << "us,"
+            << " icon " << m_statistics.iconTime / 1000 << "us"
+            << " (cache " << m_statistics.iconCacheHits << "/" << m_statistics.iconCacheHits + m_statistics.iconCacheMisses << "),"
+            << " text cache " << m_statistics.displayTextCacheHits << "/" << m_statistics.displayTextCacheHits + m_statistics.displayTextCacheMisses;
+}
+
+/// Filter
+
+void FolderModel::setFilterFlags(FilterFlags filterFlags)
+{
+    m_filterFlags = filterFlags;
+}
+
+FilterFlags FolderModel::filterFlags() const
+{
+    return m_filterFlags;
+}
+
+void FolderModel::setNameFilters(const QStringList &nameFilters)
+{
+    m_nameFilters.clear();
+
+    foreach(const QString& nf, nameFilters)
+    {
+        if(nf == "." || nf == "..")
+        {
+            continue;
+        }
+        m_nameFilters.push_back(nf);
+    }
+
+    // ワイルドカードはここで 1 つの正規表現にまとめてコンパイルしておく
+    m_nameFilterMatchAll = m_nameFilters.contains("*");
+    m_nameFilterRegExp = makeWildcardRegExp(m_nameFilters);
+}
+
+QStringList FolderModel::nameFilters() const
+{
+    return m_nameFilters;
+}
+
+void FolderModel::refilter()
+{
+    if(m_scannedSkipTypeFlags & ~scanSkipTypeFlags())
+    {
+        // 列挙の時点で除外したエントリは一覧に無いので読み直す
+        startScan();
+
+        return;
+    }
+
+    if(!m_entryOrderSorted)
+    {
+        sortEntryOrder();
+    }
+
+    updateRowList(filterEntries(m_entryOrder));
+}
+
+/// Sort
+
+void FolderModel::setSortKeys(const QList<SortKey>& sortKeys)
+{
+    m_sortKeys.clear();
+    foreach(const SortKey& sortKey, sortKeys)
+    {
+        if(sortKey.sectionType != SectionType::Unknown)
+        {
+            m_sortKeys.push_back(sortKey);
+        }
+    }
+
+    if(!m_sortKeys.isEmpty())
+    {
+        m_sortOrder = m_sortKeys.first().order;
+    }
+}
+
+QList<SortKey> FolderModel::sortKeys() const
+{
+    return m_sortKeys;
+}
+
+void FolderModel::setSortSectionType(SectionType sectionType)
+{
+    if(m_sortKeys.isEmpty())
+    {
+        m_sortKeys.push_back({sectionType, m_sortOrder});
+    }
+    else
+    {
+        m_sortKeys[0].sectionType = sectionType;
+    }
+}
+
+SectionType FolderModel::sortSectionType() const
+{
+    return (m_sortKeys.count() > 0) ? m_sortKeys[0].sectionType : SectionType::Unknown;
+}
+
+void FolderModel::setSortSectionType2nd(SectionType sectionType2nd)
+{
+    while(m_sortKeys.count() > 1)
+    {
+        m_sortKeys.removeLast();
+    }
+
+    if(sectionType2nd != SectionType::Unknown)
+    {
+        if(m_sortKeys.isEmpty())
+        {
+            m_sortKeys.push_back({SectionType::FileName, m_sortOrder});
+        }
+        m_sortKeys.push_back({sectionType2nd, m_sortOrder});
+    }
+}
+
+SectionType FolderModel::sortSectionType2nd() const
+{
+    return (m_sortKeys.count() > 1) ? m_sortKeys[1].sectionType : SectionType::Unknown;
+}
+
+void FolderModel::setSortDirsType(SortDirsType dirsType)
+{
+    finishBackgroundSort();
+
+    m_sortDirsType = dirsType;
+}
+
+SortDirsType FolderModel::sortDirsType() const
+{
+    return m_sortDirsType;
+}
+
+void FolderModel::setSortDotFirst(bool dotFirst)
+{
+    finishBackgroundSort();
+
+    m_sortDotFirst = dotFirst;
+}
+
+bool FolderModel::sortDotFirst() const
+{
+    return m_sortDotFirst;
+}
+
+void FolderModel::setSortOrder(SortOrderType order)
+{
+    m_sortOrder = order;
+
+    for(int i = 0;i < m_sortKeys.count();i++)
+    {
+        m_sortKeys[i].order = order;
+    }
+}
+
+SortOrderType FolderModel::sortOrder() const
+{
+    return m_sortOrder;
+}
+
+void FolderModel::setSortCaseSensitivity(SortCaseSensitivity sensitivity)
+{
+    finishBackgroundSort();
+
+    m_sortCaseSensitivity = sensitivity;
+
+    clearSortKeys();
+}
+
+SortCaseSensitivity FolderModel::sortCaseSensitivity() const
+{
+    return m_sortCaseSensitivity;
+}
+
+void FolderModel::setSortNaturalOrder(bool naturalOrder)
+{
+    finishBackgroundSort();
+
+    m_sortNaturalOrder = naturalOrder;
+
+    clearSortKeys();
 }
 
-FilterFlags FolderModel::filterFlags() const
+bool FolderModel::sortNaturalOrder() const
 {
-    return m_filterFlags;
+    return m_sortNaturalOrder;
 }
 
-void FolderModel::setNameFilters(const QStringList &nameFilters)
+void FolderModel::setSortLocaleAware(bool localeAware)
 {
-    m_nameFilters.clear();
-
-    foreach(const QString& nf, nameFilters)
-    {
-        if(nf == "." || nf == "..")
-        {
-            continue;
-        }
-        m_nameFilters.push_back(nf);
-    }
+    finishBackgroundSort();
 
-    QStringList _nameFilters = {".."};
-    _nameFilters += m_nameFilters;
+    m_sortLocaleAware = localeAware;
 
-    m_dir.setNameFilters(_nameFilters);
+    clearSortKeys();
 }
 
-QStringList FolderModel::nameFilters() const
+bool FolderModel::sortLocaleAware() const
 {
-    return m_nameFilters;
+    return m_sortLocaleAware;
 }
 
-/// Sort
+void FolderModel::setParallelSort(bool parallelSort)
+{
+    finishBackgroundSort();
 
-void FolderModel::setSortSectionType(SectionType sectionType)
+    m_parallelSort = parallelSort;
+}
+
+bool FolderModel::parallelSort() const
 {
-    m_sortSectionType = sectionType;
+    return m_parallelSort;
 }
 
-SectionType FolderModel::sortSectionType() const
+void FolderModel::setParallelSortThreshold(int threshold)
 {
-    return m_sortSectionType;
+    finishBackgroundSort();
+
+    m_parallelSortThreshold = threshold;
 }
 
-void FolderModel::setSortSectionType2nd(SectionType sectionType2nd)
+int FolderModel::parallelSortThreshold() const
 {
-    m_sortSectionType2nd = sectionType2nd;
+    return m_parallelSortThreshold;
 }
 
-SectionType FolderModel::sortSectionType2nd() const
+void FolderModel::setVisibleFirstSort(bool visibleFirstSort)
 {
-    return m_sortSectionType2nd;
+    finishBackgroundSort();
+
+    m_visibleFirstSort = visibleFirstSort;
 }
 
-void FolderModel::setSortDirsType(SortDirsType dirsType)
+bool FolderModel::visibleFirstSort() const
 {
-    m_sortDirsType = dirsType;
+    return m_visibleFirstSort;
 }
 
-SortDirsType FolderModel::sortDirsType() const
+void FolderModel::setVisibleFirstSortThreshold(int threshold)
 {
-    return m_sortDirsType;
+    m_visibleFirstSortThreshold = threshold;
 }
 
-void FolderModel::setSortDotFirst(bool dotFirst)
+int FolderModel::visibleFirstSortThreshold() const
 {
-    m_sortDotFirst = dotFirst;
+    return m_visibleFirstSortThreshold;
 }
 
-bool FolderModel::sortDotFirst() const
+void FolderModel::setVisibleRowRange(int firstRow, int rowCount)
 {
-    return m_sortDotFirst;
+    m_visibleFirstRow = qMax(0, firstRow);
+    m_visibleRowCount = qMax(1, rowCount);
+
+    // 表示範囲に近い順に stat し直させる
+    if(m_lazyStat && !m_statRequestTimer.isActive())
+    {
+        m_statRequestTimer.start();
+    }
 }
 
-void FolderModel::setSortOrder(SortOrderType order)
+int FolderModel::visibleFirstRow() const
 {
-    m_sortOrder = order;
+    return m_visibleFirstRow;
 }
 
-SortOrderType FolderModel::sortOrder() const
+int FolderModel::visibleRowCount() const
 {
-    return m_sortOrder;
+    return m_visibleRowCount;
 }
 
-void FolderModel::setSortCaseSensitivity(SortCaseSensitivity sensitivity)
+bool FolderModel::isSorting() const
 {
-    m_sortCaseSensitivity = sensitivity;
+    return m_backgroundSorting;
 }
 
-SortCaseSensitivity FolderModel::sortCaseSensitivity() const
+void FolderModel::onBackgroundSortFinished()
 {
-    return m_sortCaseSensitivity;
+    // 既に finishBackgroundSort() で反映済みの場合は何もしない
+    finishBackgroundSort();
 }
 
 /// Format
 
 void FolderModel::setFileSizeFormatType(FileSizeFormatType formatType)
 {
+    if(m_fileSizeFormatType == formatType)
+    {
+        return;
+    }
+
     m_fileSizeFormatType = formatType;
+
+    clearDisplayTexts();
 }
 
 FileSizeFormatType FolderModel::fileSizeFormatType() const
@@ -730,7 +3074,14 @@ FileSizeFormatType FolderModel::fileSizeFormatType() const
 
 void FolderModel::setFileSizeComma(bool comma)
 {
+    if(m_fileSizeComma == comma)
+    {
+        return;
+    }
+
     m_fileSizeComma = comma;
+
+    clearDisplayTexts();
 }
 
 bool FolderModel::fileSizeComma() const
@@ -740,7 +3091,14 @@ bool FolderModel::fileSizeComma() const
 
 void FolderModel::setDateFormatType(DateFormatType formatType)
 {
+    if(m_dateFormatType == formatType)
+    {
+        return;
+    }
+
     m_dateFormatType = formatType;
+
+    clearDisplayTexts();
 }
 
 DateFormatType FolderModel::dateFormatType() const
@@ -750,7 +3108,14 @@ DateFormatType FolderModel::dateFormatType() const
 
 void FolderModel::setDateFormatOriginalString(const QString& orgString)
 {
+    if(m_dateFormatOriginalString == orgString)
+    {
+        return;
+    }
+
     m_dateFormatOriginalString = orgString;
+
+    clearDisplayTexts();
 }
 
 QString FolderModel::dateFormatOriginalString() const
@@ -762,9 +3127,10 @@ QString FolderModel::dateFormatOriginalString() const
 
 QFileInfo FolderModel::fileInfo(const QModelIndex &index) const
 {
-    if(index.row() < m_fileInfoList.count())
+    int entry = entryIndex(index);
+    if(entry >= 0)
     {
-        return m_fileInfoList[index.row()];
+        return QFileInfo(m_dir, m_entryTable.fileName(entry));
     }
 
     return QFileInfo();
@@ -772,9 +3138,10 @@ QFileInfo FolderModel::fileInfo(const QModelIndex &index) const
 
 bool FolderModel::isDir(const QModelIndex &index) const
 {
-    if(index.row() < m_fileInfoList.count())
+    int entry = entryIndex(index);
+    if(entry >= 0)
     {
-        return m_fileInfoList[index.row()].isDir();
+        return m_entryTable.isDir(entry);
     }
 
     return false;
@@ -782,9 +3149,10 @@ bool FolderModel::isDir(const QModelIndex &index) const
 
 QString FolderModel::filePath(const QModelIndex &index) const
 {
-    if(index.row() < m_fileInfoList.count())
+    int entry = entryIndex(index);
+    if(entry >= 0)
     {
-        return m_fileInfoList[index.row()].filePath();
+        return m_dir.filePath(m_entryTable.fileName(entry));
     }
 
     return "";
@@ -792,9 +3160,10 @@ QString FolderModel::filePath(const QModelIndex &index) const
 
 QString FolderModel::fileName(const QModelIndex &index) const
 {
-    if(index.row() < m_fileInfoList.count())
+    int entry = entryIndex(index);
+    if(entry >= 0)
     {
-        return m_fileInfoList[index.row()].fileName();
+        return m_entryTable.fileName(entry);
     }
 
     return "";
@@ -807,9 +3176,15 @@ QIcon FolderModel::fileIcon(const QModelIndex &index) const
 
 QFile::Permissions FolderModel::permissions(const QModelIndex &index) const
 {
-    if(index.row() < m_fileInfoList.count())
+    int entry = entryIndex(index);
+    if(entry >= 0)
     {
-        return m_fileInfoList[index.row()].permissions();
+        if(!isStatLoaded(entry, FolderEntryTable::ModeField))
+        {
+            return QFileInfo(m_dir, m_entryTable.fileName(entry)).permissions();
+        }
+
+        return m_entryTable.permissions(entry);
     }
 
     return QFile::Permissions();
@@ -817,9 +3192,15 @@ QFile::Permissions FolderModel::permissions(const QModelIndex &index) const
 
 qint64 FolderModel::size(const QModelIndex &index) const
 {
-    if(index.row() < m_fileInfoList.count())
+    int entry = entryIndex(index);
+    if(entry >= 0)
     {
-        return m_fileInfoList[index.row()].size();
+        if(!isStatLoaded(entry, FolderEntryTable::SizeField))
+        {
+            return QFileInfo(m_dir, m_entryTable.fileName(entry)).size();
+        }
+
+        return m_entryTable.size(entry);
     }
 
     return -1;
@@ -827,9 +3208,10 @@ qint64 FolderModel::size(const QModelIndex &index) const
 
 QString FolderModel::type(const QModelIndex &index) const
 {
-    if(index.row() < m_fileInfoList.count())
+    int entry = entryIndex(index);
+    if(entry >= 0)
     {
-        return m_fileInfoList[index.row()].suffix();
+        return m_entryTable.suffix(entry);
     }
 
     return "";
@@ -837,9 +3219,15 @@ QString FolderModel::type(const QModelIndex &index) const
 
 QDateTime FolderModel::created(const QModelIndex &index) const
 {
-    if(index.row() < m_fileInfoList.count())
+    int entry = entryIndex(index);
+    if(entry >= 0)
     {
-        return m_fileInfoList[index.row()].birthTime();
+        if(!isStatLoaded(entry, FolderEntryTable::TimeField))
+        {
+            return QFileInfo(m_dir, m_entryTable.fileName(entry)).birthTime();
+        }
+
+        return nsecsToDateTime(m_entryTable.created(entry));
     }
 
     return QDateTime();
@@ -847,14 +3235,69 @@ QDateTime FolderModel::created(const QModelIndex &index) const
 
 QDateTime FolderModel::lastModified(const QModelIndex &index) const
 {
-    if(index.row() < m_fileInfoList.count())
+    int entry = entryIndex(index);
+    if(entry >= 0)
     {
-        return m_fileInfoList[index.row()].lastModified();
+        if(!isStatLoaded(entry, FolderEntryTable::TimeField))
+        {
+            return QFileInfo(m_dir, m_entryTable.fileName(entry)).lastModified();
+        }
+
+        return nsecsToDateTime(m_entryTable.lastModified(entry));
     }
 
     return QDateTime();
 }
 
+int FolderModel::entryIndex(const QModelIndex& index) const
+{
+    if(index.row() >= 0 && index.row() < m_rowList.count())
+    {
+        return m_rowList[index.row()];
+    }
+
+    return -1;
+}
+
+// 所有者名・グループ名は ID ごとにキャッシュする(Windows では ID が得られないので毎回取得する)
+QString FolderModel::ownerName(int entry) const
+{
+    uint ownerId = m_entryTable.ownerId(entry);
+
+    QHash<uint, QString>::const_iterator itr = m_ownerNameCache.find(ownerId);
+    if(itr != m_ownerNameCache.end())
+    {
+        return *itr;
+    }
+
+    QString owner = QFileInfo(m_dir, m_entryTable.fileName(entry)).owner();
+    if(ownerId != static_cast<uint>(-2))
+    {
+        m_ownerNameCache.insert(ownerId, owner);
+    }
+
+    return owner;
+}
+
+QString FolderModel::groupName(int entry) const
+{
+    uint groupId = m_entryTable.groupId(entry);
+
+    QHash<uint, QString>::const_iterator itr = m_groupNameCache.find(groupId);
+    if(itr != m_groupNameCache.end())
+    {
+        return *itr;
+    }
+
+    QString group = QFileInfo(m_dir, m_entryTable.fileName(entry)).group();
+    if(groupId != static_cast<uint>(-2))
+    {
+        m_groupNameCache.insert(groupId, group);
+    }
+
+    return group;
+}
+
 /// Appearance
 
 void FolderModel::setFont(const QFont& font)
@@ -862,97 +3305,258 @@ void FolderModel::setFont(const QFont& font)
     m_font = font;
 
     m_iconSize = QFontMetrics(font).height();
+
+    // キャッシュはサイズごとに作り直す
+    m_iconCache.clear();
 }
 
-void FolderModel::initBrushes(const QMap<ColorRoleType, QColor>& colors, bool folderColorTopPrio)
+// アイコンのキャッシュキー(フォルダ・拡張子ごと。拡張子で判定できないファイルはファイルごと)
+QString FolderModel::iconKey(int entry) const
 {
-    m_brushes.clear();
+    if(m_entryTable.isDir(entry))
+    {
+        return "<dir>";
+    }
 
-    for(auto colorRole : colors.keys())
+    if(m_entryTable.baseNameLength(entry, false) > 0)
     {
-        m_brushes[colorRole] = QBrush(colors[colorRole]);
+        QString suffix = m_entryTable.suffix(entry).toLower();
+        bool perFile = suffix.isEmpty();
+#ifdef Q_OS_WIN
+        // 実行ファイル・ショートカットなどはファイル自身のアイコンを持つ
+        perFile = perFile || suffix == "exe" || suffix == "lnk" || suffix == "ico" || suffix == "url";
+#endif
+        if(!perFile)
+        {
+            return "*." + suffix;
+        }
     }
 
-    m_folderColorTopPriority = folderColorTopPrio;
+    return "file:" + m_dir.filePath(m_entryTable.fileName(entry));
 }
 
-QBrush FolderModel::textBrush(const QModelIndex& index) const
+QPixmap FolderModel::iconPixmap(int entry) const
 {
-    QBrush ret;
-
-    QFileInfo fi = fileInfo(index);
-    bool selected = isSelected(index);
+    QString key = iconKey(entry);
 
-    if(m_folderColorTopPriority && fi.isDir())
+    QHash<QString, QPixmap>::const_iterator itr = m_iconCache.constFind(key);
+    if(itr != m_iconCache.constEnd())
     {
-        if(selected)
+        if(m_statisticsEnabled)
         {
-            ret = brush(ColorRoleType::Folder_Selected);
-        }
-        else
-        {
-            ret = brush(ColorRoleType::Folder);
+            m_statistics.iconCacheHits++;
         }
+
+        return *itr;
     }
-#ifdef Q_OS_WIN
-    else if(fi.fileName() != ".." && Win32::isSystemFile(fi.absoluteFilePath()))
+
+    if(m_statisticsEnabled)
+    {
+        m_statistics.iconCacheMisses++;
+    }
+
+#ifdef Q_OS_LINUX
+    // ファイルは MIME タイプの判定をワーカースレッドで行い、判定が終わるまでは汎用のアイコンを表示する
+    if(!m_entryTable.isDir(entry))
     {
-        if(selected)
+        QHash<QString, QVector<int>>::iterator pendingItr = m_pendingIconKeys.find(key);
+        if(pendingItr == m_pendingIconKeys.end())
         {
-            ret = brush(FolderViewColorRoleType::System_Selected);
+            // 拡張子ごとのキーは、内容で判定すると最初のファイルのアイコンを同じ拡張子の全てのファイルで使ってしまう
+            m_pendingIconKeys.insert(key, {entry});
+            m_iconLoader->requestIcon(key, m_dir.filePath(m_entryTable.fileName(entry)), key.startsWith("file:"));
         }
-        else
+        else if(!pendingItr->contains(entry))
         {
-            ret = brush(FolderViewColorRoleType::System);
+            pendingItr->push_back(entry);
         }
+
+        return cachedIconPixmap("<file>", m_fileIconProvider.icon(QFileIconProvider::File));
     }
 #endif
-    else if((fi.fileName() != "..") && (fi.isHidden()))
+
+    return cachedIconPixmap(key, m_fileIconProvider.icon(QFileInfo(m_dir, m_entryTable.fileName(entry))));
+}
+
+QPixmap FolderModel::cachedIconPixmap(const QString& key, const QIcon& icon) const
+{
+    QHash<QString, QPixmap>::const_iterator itr = m_iconCache.constFind(key);
+    if(itr != m_iconCache.constEnd())
     {
-        if(selected)
-        {
-            ret = brush(ColorRoleType::Hidden_Selected);
-        }
-        else
-        {
-            ret = brush(ColorRoleType::Hidden);
-        }
+        return *itr;
     }
-    else if((fi.fileName() != "..") && (!fi.isWritable()))
+
+    QElapsedTimer timer;
+    if(m_statisticsEnabled)
     {
-        if(selected)
-        {
-            ret = brush(ColorRoleType::ReadOnly_Selected);
-        }
-        else
-        {
-            ret = brush(ColorRoleType::ReadOnly);
-        }
+        timer.start();
+    }
+
+    QPixmap pixmap = icon.pixmap(m_iconSize, m_iconSize);
+    m_iconCache.insert(key, pixmap);
+
+    if(m_statisticsEnabled)
+    {
+        m_statistics.iconTime += timer.nsecsElapsed();
     }
-    else if(!m_folderColorTopPriority && fi.isDir())
+
+    return pixmap;
+}
+
+// ファイルごとのアイコンは、表示中のフォルダの分のみ保持する
+void FolderModel::clearFileIcons()
+{
+    m_iconLoader->clearRequests();
+    m_pendingIconKeys.clear();
+    m_iconUpdatedEntries.clear();
+
+    for(QHash<QString, QPixmap>::iterator itr = m_iconCache.begin();itr != m_iconCache.end();)
     {
-        if(selected)
+        if(itr.key().startsWith("file:"))
         {
-            ret = brush(ColorRoleType::Folder_Selected);
+            itr = m_iconCache.erase(itr);
         }
         else
         {
-            ret = brush(ColorRoleType::Folder);
+            itr++;
         }
     }
-    else
+}
+
+void FolderModel::onIconNameResolved(const QString& key, const QString& iconName, const QString& genericIconName)
+{
+    QHash<QString, QVector<int>>::iterator pendingItr = m_pendingIconKeys.find(key);
+    if(pendingItr == m_pendingIconKeys.end())
+    {
+        // フォルダを移動する前の要求
+        return;
+    }
+
+    m_iconUpdatedEntries += *pendingItr;
+    m_pendingIconKeys.erase(pendingItr);
+
+    // QFileIconProvider と同じく、アイコン名 -> 汎用アイコン名 -> ファイルアイコンの順に探す
+    QIcon fileIcon = m_fileIconProvider.icon(QFileIconProvider::File);
+    QIcon icon = QIcon::fromTheme(iconName, QIcon::fromTheme(genericIconName, fileIcon));
+
+    m_iconCache.insert(key, icon.pixmap(m_iconSize, m_iconSize));
+
+    if(!m_iconUpdateTimer.isActive())
+    {
+        m_iconUpdateTimer.start();
+    }
+}
+
+void FolderModel::onIconUpdateTimerTimeout()
+{
+    QVector<int> entries;
+    entries.swap(m_iconUpdatedEntries);
+
+    int column = m_sectionTypeList.indexOf(SectionType::FileName);
+    if(column < 0)
+    {
+        return;
+    }
+
+    // アイコンを要求した(描画された)行のみ、連続する範囲ごとに通知する
+    QVector<int> rows;
+    rows.reserve(entries.count());
+    foreach(int entry, entries)
     {
-        if(selected)
+        int row = m_entryRows.value(entry, -1);
+        if(row >= 0)
         {
-            ret = brush(ColorRoleType::Normal_Selected);
+            rows.push_back(row);
         }
-        else
+    }
+    std::sort(rows.begin(), rows.end());
+
+    for(int i = 0;i < rows.count();)
+    {
+        int firstRow = rows[i];
+        int lastRow = firstRow;
+        for(i++;i < rows.count() && rows[i] <= lastRow + 1;i++)
         {
-            ret = brush(ColorRoleType::Normal);
+            lastRow = rows[i];
         }
+
+        emit dataChanged(index(firstRow, column), index(lastRow, column), {FileIconRole});
     }
+}
 
-    return ret;
+void FolderModel::initBrushes(const QMap<ColorRoleType, QColor>& colors, bool folderColorTopPrio)
+{
+    m_brushes.fill(QBrush(), static_cast<int>(ColorRoleType::FolderViewColorRoleTypeNum));
+
+    for(auto colorRole : colors.keys())
+    {
+        m_brushes[static_cast<int>(colorRole)] = QBrush(colors[colorRole]);
+    }
+
+    m_folderColorTopPriority = folderColorTopPrio;
+
+    updateColorRoles();
+}
+
+// 文字色の種類(非選択時)をエントリごとに判定しておく
+void FolderModel::updateColorRoles(int firstEntry/* = 0*/)
+{
+    m_colorRoles.resize(m_entryTable.count());
+
+    for(int entry = firstEntry;entry < m_entryTable.count();entry++)
+    {
+        m_colorRoles[entry] = static_cast<quint8>(classifyColorRole(entry));
+    }
+}
+
+ColorRoleType FolderModel::classifyColorRole(int entry) const
+{
+    int typeFlags = m_entryTable.typeFlags(entry);
+    bool isDirEntry = (typeFlags & FolderEntryTable::Dir);
+    bool isDotDot = (typeFlags & FolderEntryTable::DotDot);
+
+    if(m_folderColorTopPriority && isDirEntry)
+    {
+        return ColorRoleType::Folder;
+    }
+#ifdef Q_OS_WIN
+    else if(!isDotDot && (typeFlags & FolderEntryTable::System))
+    {
+        return ColorRoleType::System;
+    }
+#endif
+    else if(!isDotDot && (typeFlags & FolderEntryTable::Hidden))
+    {
+        return ColorRoleType::Hidden;
+    }
+    else if(!isDotDot && !(typeFlags & FolderEntryTable::Writable) && (!m_lazyStat || isStatLoaded(entry, FolderEntryTable::ModeField)))
+    {
+        return ColorRoleType::ReadOnly;
+    }
+    else if(!m_folderColorTopPriority && isDirEntry)
+    {
+        return ColorRoleType::Folder;
+    }
+
+    return ColorRoleType::Normal;
+}
+
+QBrush FolderModel::textBrush(const QModelIndex& index) const
+{
+    int entry = entryIndex(index);
+    if(entry < 0 || entry >= m_colorRoles.count())
+    {
+        return QBrush();
+    }
+
+    // 選択時の色は ColorRoleType で非選択時の色の次に定義されている
+    int colorRole = m_colorRoles[entry];
+    if(isSelected(index))
+    {
+        colorRole++;
+    }
+
+    return m_brushes[colorRole];
 }
 
 QBrush FolderModel::backgroundBrush(const QModelIndex& index) const
@@ -973,15 +3577,7 @@ QBrush FolderModel::backgroundBrush(const QModelIndex& index) const
 
 QBrush FolderModel::brush(ColorRoleType colorRole) const
 {
-    QBrush ret;
-
-    QMap<ColorRoleType, QBrush>::const_iterator itr = m_brushes.find(colorRole);
-    if(itr != m_brushes.end())
-    {
-        ret = *itr;
-    }
-
-    return ret;
+    return m_brushes[static_cast<int>(colorRole)];
 }
 
 /// Select
@@ -999,13 +3595,42 @@ void FolderModel::setSelect(int row, QItemSelectionModel::SelectionFlags selecti
 
 void FolderModel::setSelectAll()
 {
-    for(int row = 0;row < rowCount();row++)
+    m_itemSelectionModel.select(makeRowSelection([](int){ return true; }), QItemSelectionModel::Select);
+}
+
+void FolderModel::setSelectByNameFilters(const QStringList& nameFilters,
+                                         QItemSelectionModel::SelectionFlags selectionFlags/* = QItemSelectionModel::Select*/)
+{
+    QRegularExpression regExp = makeWildcardRegExp(nameFilters);
+
+    m_itemSelectionModel.select(makeRowSelection([&](int row)
+    {
+        int entry = m_rowList[row];
+        return regExp.match(QString::fromRawData(m_entryTable.nameData(entry, false), m_entryTable.nameLength(entry, false))).hasMatch();
+    }), selectionFlags);
+}
+
+void FolderModel::setSelectIf(const std::function<bool(const QModelIndex&)>& predicate,
+                              QItemSelectionModel::SelectionFlags selectionFlags/* = QItemSelectionModel::Select*/)
+{
+    m_itemSelectionModel.select(makeRowSelection([&](int row)
+    {
+        return predicate(index(row, 0));
+    }), selectionFlags);
+}
+
+void FolderModel::invertSelected()
+{
+    QVector<bool> selectedList(m_rowList.count(), false);
+    foreach(const QItemSelectionRange& range, m_itemSelectionModel.selection())
     {
-        if(fileName(index(row, 0)) != "..")
+        for(int row = range.top();row <= range.bottom();row++)
         {
-            setSelect(row, QItemSelectionModel::Select);
+            selectedList[row] = true;
         }
     }
+
+    m_itemSelectionModel.select(makeRowSelection([&](int row){ return !selectedList[row]; }), QItemSelectionModel::ClearAndSelect);
 }
 
 QModelIndexList FolderModel::selectedIndexList() const
@@ -1023,6 +3648,51 @@ bool FolderModel::isSelected(const QModelIndex& index) const
     return m_itemSelectionModel.isSelected(index);
 }
 
+// predicate を満たす行(".." は除く)を、連続する範囲ごとにまとめた選択範囲にする
+QItemSelection FolderModel::makeRowSelection(const std::function<bool(int row)>& predicate) const
+{
+    QItemSelection selection;
+
+    int first = -1;
+    for(int row = 0;row <= m_rowList.count();row++)
+    {
+        bool accepted = (row < m_rowList.count() &&
+                         m_rowList[row] >= 0 &&
+                         !m_entryTable.isDotDot(m_rowList[row]) &&
+                         predicate(row));
+
+        if(accepted && first < 0)
+        {
+            first = row;
+        }
+        else if(!accepted && first >= 0)
+        {
+            selection.select(createIndex(first, 0), createIndex(row - 1, columnCount() - 1));
+            first = -1;
+        }
+    }
+
+    return selection;
+}
+
+QRegularExpression FolderModel::makeWildcardRegExp(const QStringList& wildcards)
+{
+    QStringList patterns;
+    foreach(const QString& wildcard, wildcards)
+    {
+        patterns.push_back("(?:" + QRegularExpression::wildcardToRegularExpression(wildcard) + ")");
+    }
+    if(patterns.isEmpty())
+    {
+        patterns.push_back("(?!)");     // 何にもマッチしない
+    }
+
+    QRegularExpression regExp(patterns.join('|'), QRegularExpression::CaseInsensitiveOption);
+    regExp.optimize();
+
+    return regExp;
+}
+
 /// Signal
 
 void FolderModel::emitRootPathChanged(const QString& path)
@@ -5,12 +5,34 @@
 #include <QItemSelectionModel>
 #include <QFileIconProvider>
 #include <QFileSystemWatcher>
+#include <QTimer>
 #include <QDir>
 #include <QFont>
+#include <QLocale>
+#include <QCollator>
+#include <QPixmap>
+#include <QSet>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QLoggingCategory>
+#include <QFutureWatcher>
+#include <functional>
+#include <vector>
+#include "folderentrytable.h"
+#include "foldersearcher.h"
+#include "folderlistingcache.h"
 
 namespace Farman
 {
 
+class FolderScanner;
+class FolderIconLoader;
+class FolderSizeCalculator;
+class FolderStatLoader;
+
+// 有効にすると読み込みごとに統計情報を出力する(ex. QT_LOGGING_RULES="farman.foldermodel.debug=true")
+Q_DECLARE_LOGGING_CATEGORY(folderModelLog)
+
 enum class SectionType : int
 {
     Unknown = -1,
@@ -42,6 +64,13 @@ enum class SortOrderType : int
     Descending = Qt::DescendingOrder,
 };
 
+// ソートキー(先頭のキーから順に比較する)
+struct SortKey
+{
+    SectionType sectionType;
+    SortOrderType order;
+};
+
 enum class SortCaseSensitivity : int
 {
     Insensitive = Qt::CaseInsensitive,
@@ -111,6 +140,34 @@ enum class FilterFlag : int
 Q_DECLARE_FLAGS(FilterFlags, FilterFlag)
 Q_DECLARE_OPERATORS_FOR_FLAGS(FilterFlags)
 
+// 表示中のエントリ数(".." は除外)
+struct FolderCounts
+{
+    int fileNum = 0;            // ファイル数(ディレクトリは含まない)
+    int dirNum = 0;             // ディレクトリ数
+    int fileDirNum = 0;         // fileNum + dirNum
+    qint64 totalSize = 0;       // ファイルサイズの合計(サイズを読み込んでいない場合は 0)
+};
+
+// 処理時間(nsec)と件数の統計(setStatisticsEnabled(true) の間のみ集計する)
+struct FolderStatistics
+{
+    qint64 enumerateTime = 0;   // ディレクトリの列挙
+    qint64 filterTime = 0;      // フィルタ
+    qint64 sortTime = 0;        // ソート
+    qint64 resetTime = 0;       // モデルのリセット・行の追加削除の通知
+    qint64 iconTime = 0;        // アイコンの取得
+
+    qint64 scannedNum = 0;      // 列挙したエントリ数
+    qint64 filteredOutNum = 0;  // フィルタで除外したエントリ数
+    qint64 compareNum = 0;      // 比較関数の呼び出し回数
+
+    qint64 displayTextCacheHits = 0;
+    qint64 displayTextCacheMisses = 0;
+    qint64 iconCacheHits = 0;
+    qint64 iconCacheMisses = 0;
+};
+
 class FolderModel : public QAbstractTableModel
 {
     Q_OBJECT
@@ -126,9 +183,15 @@ public:
     int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
     int columnCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
 
+    bool canFetchMore(const QModelIndex &parent) const Q_DECL_OVERRIDE;
+    void fetchMore(const QModelIndex &parent) Q_DECL_OVERRIDE;
+
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
 
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) Q_DECL_OVERRIDE;
+
     int refresh();
+    void resort();              // ディレクトリを読み直さずに並び替えのみ行う
 
     /// Current directory information
 
@@ -138,9 +201,66 @@ public:
     int setRootPath(const QString& path);
     QString rootPath() const;
 
-    int fileNum();              // ファイル数を返す(ディレクトリは含まない)
-    int dirNum();               // ディレクトリ数を返す(".." は除外)
-    int fileDirNum();           // fileNum() + dirNum()
+    int fileNum() const;        // ファイル数を返す(ディレクトリは含まない)
+    int dirNum() const;         // ディレクトリ数を返す(".." は除外)
+    int fileDirNum() const;     // fileNum() + dirNum()
+    FolderCounts counts() const;
+
+    /// Loading
+
+    void setAsyncLoading(bool asyncLoading);
+    bool asyncLoading() const;
+    bool isLoading() const;
+
+    // サブディレクトリ以下のエントリも相対パスで一覧に含める(常に非同期に読み込む)
+    void setRecursiveListing(bool recursiveListing);
+    bool recursiveListing() const;
+    void setRecursiveMaxDepth(int maxDepth);    // 0 = ルートのみ、-1 = 無制限
+    int recursiveMaxDepth() const;
+
+    // ビューが fetchMore() で要求した分だけディレクトリを列挙する(常に非同期に読み込む)
+    // 読み込み済みの行はその都度並べ替え、全て読み込んだ時点の並びは通常の読み込みと一致する
+    void setIncrementalFetch(bool incrementalFetch);
+    bool incrementalFetch() const;
+    void setFetchBatchSize(int batchSize);      // 1 回の fetchMore() で列挙するエントリ数
+    int fetchBatchSize() const;
+
+    // 列挙時には名前と種別(d_type)のみ取得し、表示する行の属性は表示範囲に近い行から順にバックグラウンドで stat する
+    // (ソートキーの属性は列挙時に取得する。setVisibleRowRange() で表示範囲を指定する)
+    void setLazyStat(bool lazyStat);
+    bool lazyStat() const;
+
+    // 前回の一覧をディスクから読み込んで先に表示し、差分はバックグラウンドで確認する
+    void setListingCacheEnabled(bool enabled);
+    bool listingCacheEnabled() const;
+    void setListingCacheDir(const QString& cacheDir);
+    QString listingCacheDir() const;
+
+    void setAutoUpdate(bool autoUpdate);
+    bool autoUpdate() const;
+    void setAutoUpdateInterval(int msec);
+    int autoUpdateInterval() const;
+
+    /// Search
+
+    int startSearch(const FolderSearchCondition& condition);   // rootPath() 以下を検索し、一致したエントリを相対パスの行として追加していく
+    void cancelSearch();
+    bool isSearching() const;
+    bool isSearchResult() const;            // 表示中の一覧が検索結果か(refresh() で通常の一覧に戻る)
+    FolderSearchStatistics searchStatistics() const;
+
+    /// Folder size
+
+    void setFolderSizeEnabled(bool enabled);    // フォルダ以下のサイズの合計をバックグラウンドで計算する
+    bool folderSizeEnabled() const;
+    bool isFolderSizeCalculating() const;
+
+    /// Statistics
+
+    void setStatisticsEnabled(bool enabled);
+    bool statisticsEnabled() const;
+    FolderStatistics statistics() const;
+    void resetStatistics();
 
     /// Filter
 
@@ -148,21 +268,40 @@ public:
     FilterFlags filterFlags() const;
     void setNameFilters(const QStringList &nameFilters);
     QStringList nameFilters() const;
+    void refilter();            // ディレクトリを読み直さずにフィルタのみ適用し直す
 
     /// Sort
 
-    void setSortSectionType(SectionType sectionType);
+    void setSortKeys(const QList<SortKey>& sortKeys);   // キー毎に昇順・降順を指定できる
+    QList<SortKey> sortKeys() const;
+    void setSortSectionType(SectionType sectionType);   // 1 番目のキー
     SectionType sortSectionType() const;
-    void setSortSectionType2nd(SectionType sectionType2nd);
+    void setSortSectionType2nd(SectionType sectionType2nd); // 2 番目のキー(Unknown で 2 番目以降を削除する)
     SectionType sortSectionType2nd() const;
     void setSortDirsType(SortDirsType dirsType);
     SortDirsType sortDirsType() const;
     void setSortDotFirst(bool dotFirst);
     bool sortDotFirst() const;
-    void setSortOrder(SortOrderType order);
+    void setSortOrder(SortOrderType order);             // 全てのキーの昇順・降順
     SortOrderType sortOrder() const;
     void setSortCaseSensitivity(SortCaseSensitivity sensitivity);
     SortCaseSensitivity sortCaseSensitivity() const;
+    void setSortNaturalOrder(bool naturalOrder);    // 名前の中の数字を数値として比較する(ex. file2 < file10)
+    bool sortNaturalOrder() const;
+    void setSortLocaleAware(bool localeAware);      // 名前をロケールの照合順序で比較する
+    bool sortLocaleAware() const;
+    void setParallelSort(bool parallelSort);
+    bool parallelSort() const;
+    void setParallelSortThreshold(int threshold);
+    int parallelSortThreshold() const;
+    void setVisibleFirstSort(bool visibleFirstSort);    // 表示範囲の行だけを先に並べて表示し、全体はバックグラウンドで並べ替える
+    bool visibleFirstSort() const;
+    void setVisibleFirstSortThreshold(int threshold);
+    int visibleFirstSortThreshold() const;
+    void setVisibleRowRange(int firstRow, int rowCount);    // 先に並べる行の範囲(ex. 復元するスクロール位置)
+    int visibleFirstRow() const;
+    int visibleRowCount() const;
+    bool isSorting() const;                 // バックグラウンドで並べ替え中か
 
     /// Format
 
@@ -197,25 +336,151 @@ public:
 
     QItemSelectionModel* selectionModel();
     void setSelect(int row, QItemSelectionModel::SelectionFlags selectionFlags);
-    void setSelectAll();
+    void setSelectAll();                    // ".." 以外の全ての行を選択する
+    void setSelectByNameFilters(const QStringList& nameFilters,
+                                QItemSelectionModel::SelectionFlags selectionFlags = QItemSelectionModel::Select);
+    void setSelectIf(const std::function<bool(const QModelIndex&)>& predicate,
+                     QItemSelectionModel::SelectionFlags selectionFlags = QItemSelectionModel::Select);
+    void invertSelected();                  // ".." 以外の行の選択状態を反転する
     QModelIndexList selectedIndexList() const;
     void clearSelected();
 
 Q_SIGNALS:
     void rootPathChanged(const QString& path);
+    void loadingProgress(int loadedNum);
+    void loadingFinished(int result);
+    void searchProgress(const FolderSearchStatistics& statistics);
+    void searchFinished(int result);        // 0 = 一致あり, -1 = 一致なし・中断
+
+private Q_SLOTS:
+    void onScannerEntriesFound(int scanId, const FolderEntryTable& entryTable);
+    void onScannerFinished(int scanId, int result);
+    void onSearcherProgress(int scanId, const FolderSearchStatistics& statistics);
+
+    void onDirectoryChanged(const QString& path);
+    void onUpdateTimerTimeout();
+    void onListingCacheSaveTimerTimeout();
+
+    void onIconNameResolved(const QString& key, const QString& iconName, const QString& genericIconName);
+    void onIconUpdateTimerTimeout();
+
+    void onFolderSizeCalculated(const QString& path, qint64 size);
+    void onAllFolderSizesCalculated();
+
+    void onBackgroundSortFinished();
+
+    void onStatLoaded(int requestId, const QVector<int>& entries, const FolderEntryTable& entryTable);
+    void onStatRequestTimerTimeout();
 
 private:
-    int getFileDirNum(FilterFlags filterFlags);
+    void updateEntryRows();
+    void addCounts(int entry);
+    void recount();
+
+    bool isAcceptedEntry(int entry) const;
+    bool isAcceptedEntry(int entry, FilterFlags filterFlags) const;
+    bool matchNameFilters(const QChar* fileName, int length) const;
+    int relativeNameOffset(int entry) const;
+    QVector<int> filterEntries(const QVector<int>& entryList) const;
+
+    // バックグラウンドでのソート結果
+    struct SortResult
+    {
+        QVector<int> rowList;
+        qint64 sortTime;
+        qint64 compareNum;
+    };
+
+    void sortRowList();
+    void setSortedRowList(const QVector<int>& rowList);
+    void sortEntries(QVector<int>& entryList) const;
+    qint64 sortKeyedEntries(QVector<int>& entryList) const;
+    void sortEntryOrder();
+    bool isVisibleFirstSortTarget(int count) const;
+    void partialSortEntries(QVector<int>& entryList) const;
+    void startBackgroundSort();
+    void finishBackgroundSort();
+    void applyPendingResults();
+
+    void resetEntryTable(const FolderEntryTable& entryTable);
+    void updateEntryTable(const FolderEntryTable& newEntryTable);
+    void updateRowList(const QVector<int>& newRowList, const QVector<bool>& changedList = QVector<bool>());
+    void resetRowList(const QVector<int>& newRowList);
+
+    int entryIndex(const QModelIndex& index) const;
+    QString displayText(int entry, int column) const;
+    QString formatDisplayText(int entry, SectionType sectionType) const;
+    void clearDisplayTexts();
+    QString ownerName(int entry) const;
+    QString groupName(int entry) const;
+
+    int readEntryTable(FolderEntryTable& entryTable);
+    int readEntryTableFromDir(FolderEntryTable& entryTable);
+    int requiredStatFields() const;
+    static int statFieldOf(SectionType sectionType);
+    bool isStatLoaded(int entry, int statFields) const;
+    // バックグラウンドでのソート中に受け取った属性
+    struct StatResult
+    {
+        QVector<int> entries;
+        FolderEntryTable entryTable;
+    };
 
+    void requestStat(int entry) const;
+    void applyStatResult(const QVector<int>& entries, const FolderEntryTable& entryTable);
+    void clearStats();
+    bool isListingCacheUsable() const;
+    void saveListingCache();
+    void scheduleListingCacheSave();
+    void flushListingCache();
+
+    int startScan(bool update = false);
+    FolderScanner* createScanner();
+    int scanSkipTypeFlags() const;
+    void cancelScan();
+
+    void updateEntries();
+    void updateWatchPath();
+
+    void updateFolderSizes(int firstEntry = 0);
+    qint64 sizeKey(int entry) const;
+
+    QString iconKey(int entry) const;
+    QPixmap iconPixmap(int entry) const;
+    QPixmap cachedIconPixmap(const QString& key, const QIcon& icon) const;
+    void clearFileIcons();
+
+    void updateColorRoles(int firstEntry = 0);
+    ColorRoleType classifyColorRole(int entry) const;
     QBrush textBrush(const QModelIndex& index) const;
     QBrush backgroundBrush(const QModelIndex& index) const;
     QBrush brush(ColorRoleType colorRole) const;
 
     bool isSelected(const QModelIndex& index) const;
+    QItemSelection makeRowSelection(const std::function<bool(int row)>& predicate) const;
+
+    static QRegularExpression makeWildcardRegExp(const QStringList& wildcards);
 
-    bool lessThan(const QFileInfo& l_info, const QFileInfo& r_info) const;
-    bool sectionTypeLessThan(const QFileInfo& l_info, const QFileInfo& r_info,
-                             SectionType sectionType, SectionType sectionType2nd, SortCaseSensitivity caseSensitivity) const;
+    typedef int (FolderModel::*KeyCompareFunc)(int l_entry, int r_entry) const;
+    struct CompiledSortKey
+    {
+        KeyCompareFunc compare;
+        bool descending;
+    };
+
+    bool lessThan(int l_entry, int r_entry) const;
+    void compileSortKeys() const;
+    template<SectionType sectionType> int compareKey(int l_entry, int r_entry) const;
+    void updateIdRanks(bool group, QVector<int>& ranks) const;
+    bool isSortKey(SectionType sectionType) const;
+    void nameKey(int entry, const QChar** data, int* length) const;
+    void typeKey(int entry, const QChar** data, int* length) const;
+    int compareNameKey(int l_entry, int r_entry) const;
+    void updateSortKeys() const;
+    void clearSortKeys();
+    static void appendNaturalKey(const QChar* data, int length, QString& arena);
+
+    void logStatistics(const char* operation) const;
 
     void emitRootPathChanged(const QString& path);
 
@@ -235,19 +500,90 @@ private:
 
     QDir m_dir;
 
-    QFileInfoList m_fileInfoList;
+    FolderEntryTable m_entryTable;          // フィルタ前の全エントリ(列挙順)
+    QVector<int> m_entryOrder;              // m_entryTable のインデックスをソートしたもの
+    bool m_entryOrderSorted;
+    QVector<int> m_rowList;                 // 表示中の行(m_entryTable のインデックス、フィルタ・ソート済み)
+    QVector<int> m_entryRows;               // m_rowList の逆引き(エントリ -> 行、表示していなければ -1)
+    FolderCounts m_counts;                  // m_rowList の集計
+
+    bool m_asyncLoading;
+    QPointer<FolderScanner> m_scanner;
+    int m_scanId;
+    int m_loadedNum;
+    bool m_scanUpdating;
+    bool m_updatePending;                   // 読み込み中に変更が通知されたので、読み込み後に差分を確認する
+    FolderEntryTable m_pendingEntryTable;
+
+    bool m_recursiveListing;
+    int m_recursiveMaxDepth;
+    int m_scannedSkipTypeFlags;             // 読み込んだ一覧で列挙の時点で除外した種別(refilter() で表示する場合は読み直す)
+
+    bool m_incrementalFetch;
+    int m_fetchBatchSize;
+    int m_fetchLimit;                       // 実行中のスキャンに要求済みのエントリ数(-1 = 上限なし)
+
+    bool m_lazyStat;
+    FolderStatLoader* m_statLoader;
+    int m_statRequestId;                    // m_entryTable を置き換えるごとに増やし、古い要求の結果を捨てる
+    QVector<bool> m_statLoaded;             // エントリごとの m_statLoader で属性を取得済みか
+    mutable QSet<int> m_requestedStatEntries;   // data() で要求され、まだ結果を受け取っていないエントリ
+    mutable QTimer m_statRequestTimer;
+    QList<StatResult> m_pendingStatResults;     // ソートが終わるまで反映を待つ属性
+
+    bool m_listingCacheEnabled;
+    FolderListingCache m_listingCache;
+    QTimer m_listingCacheSaveTimer;         // 差分の反映による保存は一定時間に 1 度にまとめる
+
+    bool m_searchResult;
+    FolderSearchCondition m_searchCondition;
+    QRegularExpression m_searchNameRegExp;
+    FolderSearchStatistics m_searchStatistics;
+
+    bool m_autoUpdate;
+    QTimer m_updateTimer;
+
+    mutable QHash<uint, QString> m_ownerNameCache;
+    mutable QHash<uint, QString> m_groupNameCache;
+
+    bool m_folderSizeEnabled;
+    FolderSizeCalculator* m_folderSizeCalculator;
+    QVector<qint64> m_folderSizes;          // エントリごとのフォルダ以下のサイズの合計(未計算・フォルダ以外は -1)
+    QHash<QString, qint64> m_pendingFolderSizes;    // ソートが終わるまで反映を待つサイズ(パス -> サイズ)
 
     QList<SectionType> m_sectionTypeList;
 
     FilterFlags m_filterFlags;
     QStringList m_nameFilters;
+    QRegularExpression m_nameFilterRegExp;
+    bool m_nameFilterMatchAll;
 
-    SectionType m_sortSectionType;
-    SectionType m_sortSectionType2nd;
+    QList<SortKey> m_sortKeys;
     SortDirsType m_sortDirsType;
     bool m_sortDotFirst;
     SortOrderType m_sortOrder;
     SortCaseSensitivity m_sortCaseSensitivity;
+    bool m_sortNaturalOrder;
+    bool m_sortLocaleAware;
+    bool m_parallelSort;
+    int m_parallelSortThreshold;            // このエントリ数以上の場合に並列にソートする
+    bool m_visibleFirstSort;
+    int m_visibleFirstSortThreshold;        // この行数以上の場合に表示範囲を先に並べる
+    int m_visibleFirstRow;
+    int m_visibleRowCount;
+    bool m_backgroundSorting;               // m_sortWatcher の結果をまだ m_rowList に反映していない
+    QFutureWatcher<SortResult> m_sortWatcher;
+
+    // 名前の比較キー(ソートの前にエントリごとに 1 度だけ作る)
+    mutable QString m_naturalKeyArena;
+    mutable QVector<int> m_naturalKeyOffsets;
+    mutable QVector<int> m_naturalKeyLengths;
+    mutable std::vector<QCollatorSortKey> m_collationKeys;     // QCollatorSortKey は既定のコンストラクタが無い
+
+    // m_sortKeys をソートの前に比較関数の列に変換したもの
+    mutable QVector<CompiledSortKey> m_compiledSortKeys;
+    mutable QVector<int> m_ownerRanks;      // エントリごとの所有者名の順位
+    mutable QVector<int> m_groupRanks;      // エントリごとのグループ名の順位
 
     FileSizeFormatType m_fileSizeFormatType;
     bool m_fileSizeComma;
@@ -257,12 +593,25 @@ private:
     DateFormatType m_dateFormatType;
     QString m_dateFormatOriginalString;
 
+    QLocale m_locale;
+    QLocale m_englishLocale;                // 桁区切り(",")用
+    mutable QVector<QVector<QString>> m_displayTextCache;  // [列][エントリ] の表示文字列
+
     QFont m_font;
-    QMap<ColorRoleType, QBrush> m_brushes;
+    QVector<QBrush> m_brushes;              // ColorRoleType でインデックスする
+    QVector<quint8> m_colorRoles;           // エントリごとの文字色(非選択時の ColorRoleType)
 
     int m_iconSize;
+    FolderIconLoader* m_iconLoader;
+    mutable QHash<QString, QPixmap> m_iconCache;    // iconKey() -> m_iconSize のピクスマップ
+    mutable QHash<QString, QVector<int>> m_pendingIconKeys;     // m_iconLoader で判定中のキー -> アイコンを要求したエントリ
+    QVector<int> m_iconUpdatedEntries;      // m_iconUpdateTimer で描き直させるエントリ
+    QTimer m_iconUpdateTimer;
 
     bool m_folderColorTopPriority;
+
+    bool m_statisticsEnabled;
+    mutable FolderStatistics m_statistics;
 };
 
 }           // namespace Farman
@@ -0,0 +1,258 @@
+﻿#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QScopedPointer>
+#include "folderscanner.h"
+#ifdef Q_OS_LINUX
+#include "linux.h"
+#endif
+
+namespace Farman
+{
+
+namespace
+{
+
+// 1 度に読み進めるエントリ数(この間隔で中断・上限・通知間隔を確認する)
+const int ReadChunkSize = 256;
+
+}           // namespace
+
+FolderScanner::FolderScanner(int scanId, const QDir& dir, QObject *parent/* = Q_NULLPTR*/)
+    : QThread(parent)
+    , m_scanId(scanId)
+    , m_dir(dir)
+    , m_batchSize(1000)
+    , m_batchInterval(100)
+    , m_statFields(FolderEntryTable::AllStatFields)
+    , m_fetchMutex()
+    , m_fetchCondition()
+    , m_fetchLimit(-1)
+{
+}
+
+FolderScanner::~FolderScanner()
+{
+}
+
+int FolderScanner::scanId() const
+{
+    return m_scanId;
+}
+
+const QDir& FolderScanner::dir() const
+{
+    return m_dir;
+}
+
+void FolderScanner::setBatchSize(int batchSize)
+{
+    m_batchSize = batchSize;
+}
+
+int FolderScanner::batchSize() const
+{
+    return m_batchSize;
+}
+
+void FolderScanner::setBatchInterval(int msec)
+{
+    m_batchInterval = msec;
+}
+
+int FolderScanner::batchInterval() const
+{
+    return m_batchInterval;
+}
+
+void FolderScanner::setStatFields(int statFields)
+{
+    m_statFields = statFields;
+}
+
+int FolderScanner::statFields() const
+{
+    return m_statFields;
+}
+
+void FolderScanner::setFetchLimit(int fetchLimit)
+{
+    QMutexLocker locker(&m_fetchMutex);
+
+    m_fetchLimit = fetchLimit;
+    m_fetchCondition.wakeAll();
+}
+
+int FolderScanner::fetchLimit() const
+{
+    QMutexLocker locker(&m_fetchMutex);
+
+    return m_fetchLimit;
+}
+
+void FolderScanner::cancel()
+{
+    requestInterruption();
+
+    m_fetchMutex.lock();
+    m_fetchCondition.wakeAll();
+    m_fetchMutex.unlock();
+}
+
+// 列挙したエントリ数が上限に達していれば、上限が増えるか中断されるまで待つ(中断された場合は false)
+bool FolderScanner::waitFetchLimit(int entryNum)
+{
+    QMutexLocker locker(&m_fetchMutex);
+
+    while(m_fetchLimit >= 0 && entryNum >= m_fetchLimit)
+    {
+        if(isInterruptionRequested())
+        {
+            return false;
+        }
+
+        m_fetchCondition.wait(&m_fetchMutex);
+    }
+
+    return true;
+}
+
+void FolderScanner::run()
+{
+    FolderEntryTable batch;
+    int entryNum = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+#ifdef Q_OS_LINUX
+    // getdents で列挙し、m_statFields の属性のみ stat する(読めない場合は QDirIterator で列挙する)
+    Linux::FolderReader reader;
+    bool nativeRead = (reader.open(m_dir.path(), m_statFields) == 0);
+#else
+    bool nativeRead = false;
+#endif
+    QScopedPointer<QDirIterator> dirIterator((nativeRead) ? Q_NULLPTR : new QDirIterator(m_dir));
+
+    auto readEntries = [&](int maxCount) -> int
+    {
+#ifdef Q_OS_LINUX
+        if(nativeRead)
+        {
+            return reader.read(maxCount, batch);
+        }
+#endif
+
+        int readNum = 0;
+        while(readNum < maxCount && dirIterator->hasNext())
+        {
+            dirIterator->next();
+            appendEntry(dirIterator->fileInfo(), batch);
+            readNum++;
+        }
+
+        return readNum;
+    };
+
+    for(;;)
+    {
+        if(isInterruptionRequested())
+        {
+            return;
+        }
+
+        int limit = fetchLimit();
+        if(limit >= 0 && entryNum >= limit)
+        {
+            // 上限までの分を通知してから、次の要求(fetchMore)まで残りのエントリを読まずに待つ
+            if(!batch.isEmpty())
+            {
+                emit entriesFound(m_scanId, batch);
+
+                batch.clear();
+            }
+
+            if(!waitFetchLimit(entryNum))
+            {
+                return;
+            }
+
+            timer.restart();
+            limit = fetchLimit();
+        }
+
+        int maxCount = qMin(m_batchSize - batch.count(), ReadChunkSize);
+        if(limit >= 0)
+        {
+            maxCount = qMin(maxCount, limit - entryNum);
+        }
+
+        int readNum = readEntries(qMax(1, maxCount));
+        if(readNum <= 0)
+        {
+            break;
+        }
+        entryNum += readNum;
+
+        if(batch.count() >= m_batchSize || timer.elapsed() >= m_batchInterval)
+        {
+            emit entriesFound(m_scanId, batch);
+
+            batch.clear();
+            timer.restart();
+        }
+    }
+
+    if(isInterruptionRequested())
+    {
+        return;
+    }
+
+    if(!batch.isEmpty())
+    {
+        emit entriesFound(m_scanId, batch);
+    }
+
+    emit scanFinished(m_scanId, (entryNum > 0) ? 0 : -1);
+}
+
+void FolderScanner::appendEntry(const QFileInfo& fileInfo, FolderEntryTable& batch) const
+{
+    if(m_statFields == FolderEntryTable::NoStatField)
+    {
+        // 属性を使わない場合は、列挙時に分かる種別(d_type)と名前のみ記録して stat しない
+        QString fileName = fileInfo.fileName();
+
+        int typeFlags = 0;
+        if(fileInfo.isDir())
+        {
+            typeFlags |= FolderEntryTable::Dir;
+        }
+        else if(fileInfo.isFile())
+        {
+            typeFlags |= FolderEntryTable::File;
+        }
+        if(fileInfo.isSymLink())
+        {
+            typeFlags |= FolderEntryTable::SymLink;
+        }
+        if(fileName == "..")
+        {
+            typeFlags |= FolderEntryTable::DotDot;
+        }
+        else if(fileInfo.isHidden())
+        {
+            typeFlags |= FolderEntryTable::Hidden;
+        }
+
+        batch.setStatFields(FolderEntryTable::NoStatField);
+        batch.append(fileName, typeFlags, 0, 0, 0, QFile::Permissions(), 0, 0);
+    }
+    else
+    {
+        // 属性の取得(stat)は GUI スレッドではなくここで済ませておく
+        batch.append(fileInfo);
+    }
+}
+
+}           // namespace Farman
@@ -0,0 +1,64 @@
+﻿#ifndef FOLDERSCANNER_H
+#define FOLDERSCANNER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QDir>
+#include <QFileInfo>
+#include "folderentrytable.h"
+
+namespace Farman
+{
+
+// ディレクトリの列挙をワーカースレッドで行い、結果をバッチ単位で通知する
+class FolderScanner : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit FolderScanner(int scanId, const QDir& dir, QObject *parent = Q_NULLPTR);
+    ~FolderScanner() Q_DECL_OVERRIDE;
+
+    int scanId() const;
+    const QDir& dir() const;
+
+    void setBatchSize(int batchSize);
+    int batchSize() const;
+    void setBatchInterval(int msec);
+    int batchInterval() const;
+    void setStatFields(int statFields);     // FolderEntryTable::StatField
+    int statFields() const;
+
+    // 列挙するエントリ数の上限(-1 = 無制限)。上限に達すると、上限が増えるまで列挙を止めて待つ
+    void setFetchLimit(int fetchLimit);
+    int fetchLimit() const;
+
+    void cancel();              // requestInterruption() に加えて、上限待ちの列挙も中断させる
+
+Q_SIGNALS:
+    void entriesFound(int scanId, const FolderEntryTable& entryTable);
+    void scanFinished(int scanId, int result);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    bool waitFetchLimit(int entryNum);
+    void appendEntry(const QFileInfo& fileInfo, FolderEntryTable& batch) const;
+
+    int m_scanId;
+    QDir m_dir;
+
+    int m_batchSize;            // 1 回の通知でまとめるエントリ数の上限
+    int m_batchInterval;        // 通知間隔の上限(msec)
+    int m_statFields;
+
+    mutable QMutex m_fetchMutex;
+    QWaitCondition m_fetchCondition;
+    int m_fetchLimit;
+};
+
+}           // namespace Farman
+
+#endif // FOLDERSCANNER_H
@@ -0,0 +1,188 @@
+﻿#include <QFile>
+#include <cstring>
+#include "foldersearcher.h"
+
+namespace Farman
+{
+
+FolderSearcher::FolderSearcher(int scanId, const QDir& dir, QObject *parent/* = Q_NULLPTR*/)
+    : FolderTreeScanner(scanId, dir, parent)
+    , m_nameRegExp()
+    , m_nameMatchAll(true)
+    , m_contentPattern()
+    , m_timer()
+    , m_progressTimer()
+    , m_progressInterval(200)
+    , m_fileNum(0)
+    , m_contentFileNum(0)
+    , m_contentBytes(0)
+    , m_binaryFileNum(0)
+    , m_matchedNum(0)
+{
+    setContentText(QString(), Qt::CaseSensitive);
+}
+
+FolderSearcher::~FolderSearcher()
+{
+}
+
+void FolderSearcher::setNameRegExp(const QRegularExpression& regExp)
+{
+    m_nameRegExp = regExp;
+    m_nameMatchAll = !regExp.isValid() || regExp.pattern().isEmpty();
+
+    if(!m_nameMatchAll)
+    {
+        m_nameRegExp.optimize();
+    }
+}
+
+void FolderSearcher::setContentText(const QString& text, Qt::CaseSensitivity caseSensitivity)
+{
+    for(int c = 0;c < 256;c++)
+    {
+        m_foldTable[c] = static_cast<uchar>((caseSensitivity == Qt::CaseInsensitive && c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c);
+    }
+
+    m_contentPattern = text.toUtf8();
+    uchar* pattern = reinterpret_cast<uchar*>(m_contentPattern.data());
+    for(int i = 0;i < m_contentPattern.size();i++)
+    {
+        pattern[i] = m_foldTable[pattern[i]];
+    }
+
+    // 照合範囲の末尾のバイトから、次に照合する位置までのずらし幅を求めておく
+    int length = m_contentPattern.size();
+    for(int c = 0;c < 256;c++)
+    {
+        m_shiftTable[c] = length;
+    }
+    for(int i = 0;i < length - 1;i++)
+    {
+        m_shiftTable[pattern[i]] = length - 1 - i;
+    }
+}
+
+void FolderSearcher::setProgressInterval(int msec)
+{
+    m_progressInterval = msec;
+}
+
+void FolderSearcher::run()
+{
+    m_timer.start();
+    m_progressTimer.start();
+
+    FolderTreeScanner::run();
+}
+
+bool FolderSearcher::matchEntry(const QString& folderPath, const FolderEntryTable& entryTable, int entry)
+{
+    bool isDirEntry = entryTable.isDir(entry);
+    if(!isDirEntry)
+    {
+        m_fileNum.fetchAndAddRelaxed(1);
+    }
+
+    if(!m_nameMatchAll && !m_nameRegExp.match(entryTable.fileName(entry)).hasMatch())
+    {
+        return false;
+    }
+
+    if(!m_contentPattern.isEmpty())
+    {
+        // 内容を検索する場合はファイルのみを対象にする
+        if(isDirEntry || !matchContent(folderPath + '/' + entryTable.fileName(entry)))
+        {
+            return false;
+        }
+    }
+
+    m_matchedNum.fetchAndAddRelaxed(1);
+
+    return true;
+}
+
+bool FolderSearcher::matchContent(const QString& filePath)
+{
+    QFile file(filePath);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    qint64 size = file.size();
+    if(size < m_contentPattern.size())
+    {
+        return false;
+    }
+
+    const uchar* data = file.map(0, size);
+    if(data == Q_NULLPTR)
+    {
+        return false;
+    }
+
+    // 先頭に NUL を含むファイルはバイナリとして扱う
+    if(std::memchr(data, 0, static_cast<size_t>(qMin<qint64>(size, 8192))) != Q_NULLPTR)
+    {
+        m_binaryFileNum.fetchAndAddRelaxed(1);
+
+        return false;
+    }
+
+    m_contentFileNum.fetchAndAddRelaxed(1);
+    m_contentBytes.fetchAndAddRelaxed(size);
+
+    return findContent(data, size);         // マップは file の破棄時に解除される
+}
+
+bool FolderSearcher::findContent(const uchar* data, qint64 size) const
+{
+    const uchar* pattern = reinterpret_cast<const uchar*>(m_contentPattern.constData());
+    int length = m_contentPattern.size();
+
+    for(qint64 pos = 0;pos <= size - length;)
+    {
+        int i = length - 1;
+        while(i >= 0 && m_foldTable[data[pos + i]] == pattern[i])
+        {
+            i--;
+        }
+        if(i < 0)
+        {
+            return true;
+        }
+
+        pos += m_shiftTable[m_foldTable[data[pos + length - 1]]];
+    }
+
+    return false;
+}
+
+void FolderSearcher::chunkScanned(bool finished)
+{
+    if(!finished && m_progressTimer.elapsed() < m_progressInterval)
+    {
+        return;
+    }
+
+    m_progressTimer.restart();
+
+    emit searchProgress(scanId(), statistics());
+}
+
+FolderSearchStatistics FolderSearcher::statistics() const
+{
+    FolderSearchStatistics statistics;
+    statistics.fileNum = m_fileNum.load();
+    statistics.contentFileNum = m_contentFileNum.load();
+    statistics.contentBytes = m_contentBytes.load();
+    statistics.binaryFileNum = m_binaryFileNum.load();
+    statistics.matchedNum = m_matchedNum.load();
+    statistics.elapsedTime = m_timer.elapsed();
+
+    return statistics;
+}
+
+}           // namespace Farman
@@ -0,0 +1,84 @@
+﻿#ifndef FOLDERSEARCHER_H
+#define FOLDERSEARCHER_H
+
+#include <QRegularExpression>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QStringList>
+#include "foldertreescanner.h"
+
+namespace Farman
+{
+
+// 検索条件
+struct FolderSearchCondition
+{
+    QStringList nameFilters;                // ファイル名のワイルドカード(空の場合は全て)
+    QString namePattern;                    // ファイル名の正規表現(指定した場合は nameFilters より優先)
+    QString contentText;                    // ファイルの内容に含まれる文字列(UTF-8、空の場合は内容を検索しない)
+    Qt::CaseSensitivity caseSensitivity = Qt::CaseInsensitive;  // 内容は ASCII の範囲のみ大文字小文字を区別しない
+    int maxDepth = -1;                      // 0 = ルートのみ、-1 = 無制限
+};
+
+// 検索の経過(elapsedTime は msec、スループットは contentBytes / elapsedTime で求める)
+struct FolderSearchStatistics
+{
+    qint64 fileNum = 0;             // 名前を照合したファイル数
+    qint64 contentFileNum = 0;      // 内容を検索したファイル数
+    qint64 contentBytes = 0;        // 内容を検索したバイト数
+    qint64 binaryFileNum = 0;       // バイナリとして内容の検索を省いたファイル数
+    qint64 matchedNum = 0;          // 一致したエントリ数
+    qint64 elapsedTime = 0;
+};
+
+// FolderTreeScanner の列挙結果のうち、条件に一致するエントリのみを通知する
+class FolderSearcher : public FolderTreeScanner
+{
+    Q_OBJECT
+
+public:
+    explicit FolderSearcher(int scanId, const QDir& dir, QObject *parent = Q_NULLPTR);
+    ~FolderSearcher() Q_DECL_OVERRIDE;
+
+    void setNameRegExp(const QRegularExpression& regExp);      // 無効な正規表現の場合は全て一致する
+    void setContentText(const QString& text, Qt::CaseSensitivity caseSensitivity);
+    void setProgressInterval(int msec);
+
+Q_SIGNALS:
+    void searchProgress(int scanId, const FolderSearchStatistics& statistics);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+    bool matchEntry(const QString& folderPath, const FolderEntryTable& entryTable, int entry) Q_DECL_OVERRIDE;
+    void chunkScanned(bool finished) Q_DECL_OVERRIDE;
+
+private:
+    bool matchContent(const QString& filePath);
+    bool findContent(const uchar* data, qint64 size) const;
+
+    FolderSearchStatistics statistics() const;
+
+    QRegularExpression m_nameRegExp;
+    bool m_nameMatchAll;
+
+    QByteArray m_contentPattern;            // 大文字小文字を区別しない場合は小文字にしたもの
+    uchar m_foldTable[256];                 // 比較前に各バイトへ適用する変換
+    int m_shiftTable[256];                  // Boyer-Moore-Horspool のずらし幅
+
+    QElapsedTimer m_timer;
+    QElapsedTimer m_progressTimer;
+    int m_progressInterval;
+
+    QAtomicInteger<qint64> m_fileNum;
+    QAtomicInteger<qint64> m_contentFileNum;
+    QAtomicInteger<qint64> m_contentBytes;
+    QAtomicInteger<qint64> m_binaryFileNum;
+    QAtomicInteger<qint64> m_matchedNum;
+};
+
+}           // namespace Farman
+
+Q_DECLARE_METATYPE(Farman::FolderSearchStatistics)
+
+#endif // FOLDERSEARCHER_H
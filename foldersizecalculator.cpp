@@ -0,0 +1,229 @@
+﻿#include <QRunnable>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QStack>
+#include <QPair>
+#include <QFile>
+#include "foldersizecalculator.h"
+#ifdef Q_OS_LINUX
+#include <sys/stat.h>
+#endif
+
+namespace Farman
+{
+
+class FolderSizeCalculator::Task : public QRunnable
+{
+public:
+    Task(FolderSizeCalculator* calculator, int generation, const QString& path, qint64 lastModified, int progressInterval)
+        : m_calculator(calculator)
+        , m_generation(generation)
+        , m_path(path)
+        , m_lastModified(lastModified)
+        , m_progressInterval(progressInterval)
+    {
+    }
+
+    void run() Q_DECL_OVERRIDE
+    {
+        qint64 size = 0;
+        QSet<QPair<quint64, quint64>> linkedFiles;      // 数えたハードリンク(st_dev, st_ino)
+
+        QElapsedTimer timer;
+        timer.start();
+
+        // 再帰せずに未走査のフォルダのみ積んでおく(深い階層でもスタックを使い切らない)
+        // シンボリックリンクは辿らない(循環と二重計上を避ける)
+        QStack<QString> pendingDirs;
+        pendingDirs.push(m_path);
+        while(!pendingDirs.isEmpty())
+        {
+            QDirIterator dirIterator(pendingDirs.pop(), QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System | QDir::NoSymLinks);
+            while(dirIterator.hasNext())
+            {
+                if(isCanceled())
+                {
+                    return;
+                }
+
+                dirIterator.next();
+
+                QFileInfo fileInfo = dirIterator.fileInfo();
+                if(fileInfo.isDir())
+                {
+                    pendingDirs.push(fileInfo.filePath());
+                }
+                else
+                {
+                    size += fileSize(fileInfo, linkedFiles);
+                }
+
+                if(timer.elapsed() >= m_progressInterval)
+                {
+                    notify(size, false);
+
+                    timer.restart();
+                }
+            }
+        }
+
+        if(!isCanceled())
+        {
+            notify(size, true);
+        }
+    }
+
+private:
+    // ハードリンクされたファイルは、フォルダ内で何度現れても 1 度だけ数える
+    static qint64 fileSize(const QFileInfo& fileInfo, QSet<QPair<quint64, quint64>>& linkedFiles)
+    {
+#ifdef Q_OS_LINUX
+        struct stat st;
+        if(::lstat(QFile::encodeName(fileInfo.filePath()).constData(), &st) != 0)
+        {
+            return 0;
+        }
+
+        if(st.st_nlink > 1)
+        {
+            QPair<quint64, quint64> fileId(static_cast<quint64>(st.st_dev), static_cast<quint64>(st.st_ino));
+            if(linkedFiles.contains(fileId))
+            {
+                return 0;
+            }
+
+            linkedFiles.insert(fileId);
+        }
+
+        return static_cast<qint64>(st.st_size);
+#else
+        Q_UNUSED(linkedFiles);
+
+        return fileInfo.size();
+#endif
+    }
+
+    bool isCanceled() const
+    {
+        return m_calculator->m_generation.load() != m_generation;
+    }
+
+    void notify(qint64 size, bool finished)
+    {
+        QMetaObject::invokeMethod(m_calculator, "onTaskProgress", Qt::QueuedConnection,
+                                  Q_ARG(int, m_generation),
+                                  Q_ARG(QString, m_path),
+                                  Q_ARG(qint64, m_lastModified),
+                                  Q_ARG(qint64, size),
+                                  Q_ARG(bool, finished));
+    }
+
+    FolderSizeCalculator* m_calculator;
+    int m_generation;
+    QString m_path;
+    qint64 m_lastModified;
+    int m_progressInterval;
+};
+
+FolderSizeCalculator::FolderSizeCalculator(QObject *parent/* = Q_NULLPTR*/)
+    : QObject(parent)
+    , m_threadPool()
+    , m_generation(0)
+    , m_pendingPaths()
+    , m_cache(10000)
+    , m_progressInterval(100)
+{
+}
+
+FolderSizeCalculator::~FolderSizeCalculator()
+{
+    cancel();
+    m_threadPool.waitForDone();
+}
+
+bool FolderSizeCalculator::cachedSize(const QString& path, qint64 lastModified, qint64* size) const
+{
+    const CacheItem* item = m_cache.object(path);
+    if(item == Q_NULLPTR || item->lastModified != lastModified)
+    {
+        return false;
+    }
+
+    *size = item->size;
+
+    return true;
+}
+
+void FolderSizeCalculator::requestSize(const QString& path, qint64 lastModified)
+{
+    if(m_pendingPaths.contains(path))
+    {
+        return;
+    }
+
+    m_pendingPaths.insert(path);
+
+    m_threadPool.start(new Task(this, m_generation.load(), path, lastModified, m_progressInterval));
+}
+
+void FolderSizeCalculator::cancel()
+{
+    m_generation.ref();
+    m_threadPool.clear();           // 開始前のタスクは破棄する
+    m_pendingPaths.clear();
+}
+
+bool FolderSizeCalculator::isCalculating() const
+{
+    return !m_pendingPaths.isEmpty();
+}
+
+void FolderSizeCalculator::setCacheLimit(int limit)
+{
+    m_cache.setMaxCost(limit);
+}
+
+int FolderSizeCalculator::cacheLimit() const
+{
+    return m_cache.maxCost();
+}
+
+void FolderSizeCalculator::setProgressInterval(int msec)
+{
+    m_progressInterval = msec;
+}
+
+int FolderSizeCalculator::progressInterval() const
+{
+    return m_progressInterval;
+}
+
+void FolderSizeCalculator::onTaskProgress(int generation, const QString& path, qint64 lastModified, qint64 size, bool finished)
+{
+    if(generation != m_generation.load())
+    {
+        // cancel() 前の要求
+        return;
+    }
+
+    if(!finished)
+    {
+        emit sizeProgress(path, size);
+
+        return;
+    }
+
+    m_cache.insert(path, new CacheItem{lastModified, size});
+    m_pendingPaths.remove(path);
+
+    emit sizeCalculated(path, size);
+
+    if(m_pendingPaths.isEmpty())
+    {
+        emit allCalculated();
+    }
+}
+
+}           // namespace Farman
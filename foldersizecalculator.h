@@ -0,0 +1,62 @@
+﻿#ifndef FOLDERSIZECALCULATOR_H
+#define FOLDERSIZECALCULATOR_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QCache>
+#include <QSet>
+
+namespace Farman
+{
+
+// フォルダ以下のファイルサイズの合計をスレッドプールで計算する(ハードリンクは 1 度だけ数える)
+// 結果はパス毎に保持し、フォルダの更新日時が変わっていれば計算し直す
+// 更新日時はそのフォルダ自身のもののみ見るので、下位のフォルダでの追加・削除やファイルサイズの変化は、
+// キャッシュから外れるまで反映されない(表示用の概算値として扱う)
+class FolderSizeCalculator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FolderSizeCalculator(QObject *parent = Q_NULLPTR);
+    ~FolderSizeCalculator() Q_DECL_OVERRIDE;
+
+    bool cachedSize(const QString& path, qint64 lastModified, qint64* size) const;
+    void requestSize(const QString& path, qint64 lastModified);
+    void cancel();                          // 計算中・待機中の要求を全て破棄する
+    bool isCalculating() const;
+
+    void setCacheLimit(int limit);          // 保持するフォルダ数の上限
+    int cacheLimit() const;
+
+    void setProgressInterval(int msec);     // 途中経過の通知間隔
+    int progressInterval() const;
+
+Q_SIGNALS:
+    void sizeProgress(const QString& path, qint64 size);
+    void sizeCalculated(const QString& path, qint64 size);
+    void allCalculated();
+
+private Q_SLOTS:
+    void onTaskProgress(int generation, const QString& path, qint64 lastModified, qint64 size, bool finished);
+
+private:
+    struct CacheItem
+    {
+        qint64 lastModified;
+        qint64 size;
+    };
+
+    class Task;
+
+    QThreadPool m_threadPool;
+    QAtomicInt m_generation;                // cancel() で進め、古い要求の計算を打ち切る
+    QSet<QString> m_pendingPaths;
+    QCache<QString, CacheItem> m_cache;
+    int m_progressInterval;
+};
+
+}           // namespace Farman
+
+#endif // FOLDERSIZECALCULATOR_H
@@ -0,0 +1,164 @@
+﻿#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include "folderstatloader.h"
+#ifdef Q_OS_LINUX
+#include "linux.h"
+#endif
+
+namespace Farman
+{
+
+FolderStatLoader::FolderStatLoader(QObject *parent/* = Q_NULLPTR*/)
+    : QThread(parent)
+    , m_mutex()
+    , m_waitCondition()
+    , m_requestId(0)
+    , m_statFields(FolderEntryTable::AllStatFields)
+    , m_entries()
+    , m_filePaths()
+    , m_nextRequest(0)
+    , m_takenEntries()
+{
+}
+
+FolderStatLoader::~FolderStatLoader()
+{
+    stop();
+}
+
+void FolderStatLoader::setRequests(int requestId, int statFields, const QVector<int>& entries, const QStringList& filePaths)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if(requestId != m_requestId)
+    {
+        m_takenEntries.clear();
+    }
+
+    m_requestId = requestId;
+    m_statFields = statFields;
+    m_entries.clear();
+    m_filePaths.clear();
+    m_nextRequest = 0;
+
+    // 取り出し済みのエントリ(結果を通知する前のものも含む)は除き、残りを新しい順序で並べ直す
+    for(int i = 0;i < entries.count();i++)
+    {
+        if(!m_takenEntries.contains(entries[i]))
+        {
+            m_entries.push_back(entries[i]);
+            m_filePaths.push_back(filePaths[i]);
+        }
+    }
+    m_waitCondition.wakeOne();
+
+    locker.unlock();
+
+    if(!isRunning())
+    {
+        start(QThread::LowPriority);
+    }
+}
+
+void FolderStatLoader::clearRequests()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_entries.clear();
+    m_filePaths.clear();
+    m_nextRequest = 0;
+    m_takenEntries.clear();
+}
+
+void FolderStatLoader::stop()
+{
+    if(!isRunning())
+    {
+        return;
+    }
+
+    requestInterruption();
+
+    m_mutex.lock();
+    m_waitCondition.wakeAll();
+    m_mutex.unlock();
+
+    wait();
+}
+
+void FolderStatLoader::run()
+{
+    // 1 回の通知でまとめるエントリ数と間隔(msec)の上限
+    const int batchSize = 64;
+    const int batchInterval = 50;
+
+    FolderEntryTable batch;
+    QVector<int> batchEntries;
+    int batchRequestId = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while(!isInterruptionRequested())
+    {
+        m_mutex.lock();
+
+        // 要求が置き換えられた場合は、古い要求の分をそれまでに通知する
+        bool replaced = (!batchEntries.isEmpty() && batchRequestId != m_requestId);
+        bool empty = (m_nextRequest >= m_entries.count());
+        if((replaced || empty) && !batchEntries.isEmpty())
+        {
+            m_mutex.unlock();
+
+            emit statLoaded(batchRequestId, batchEntries, batch);
+
+            batch.clear();
+            batchEntries.clear();
+            timer.restart();
+
+            continue;
+        }
+
+        while(m_nextRequest >= m_entries.count() && !isInterruptionRequested())
+        {
+            m_waitCondition.wait(&m_mutex);
+        }
+        if(isInterruptionRequested())
+        {
+            m_mutex.unlock();
+            break;
+        }
+        batchRequestId = m_requestId;
+        int statFields = m_statFields;
+        int entry = m_entries[m_nextRequest];
+        QString filePath = m_filePaths[m_nextRequest];
+        m_nextRequest++;
+        m_takenEntries.insert(entry);
+        m_mutex.unlock();
+
+        // ネットワーク上のファイルシステムでは 1 回ごとに往復するので、GUI スレッドでは行わない
+#ifdef Q_OS_LINUX
+        if(batch.isEmpty())
+        {
+            batch.setStatFields(statFields);
+        }
+        Linux::appendFileEntry(filePath, statFields, batch);
+#else
+        Q_UNUSED(statFields);
+        batch.append(QFileInfo(filePath));
+#endif
+        batchEntries.push_back(entry);
+
+        if(batchEntries.count() >= batchSize || timer.elapsed() >= batchInterval)
+        {
+            emit statLoaded(batchRequestId, batchEntries, batch);
+
+            batch.clear();
+            batchEntries.clear();
+            timer.restart();
+        }
+    }
+}
+
+}           // namespace Farman
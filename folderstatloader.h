@@ -0,0 +1,49 @@
+﻿#ifndef FOLDERSTATLOADER_H
+#define FOLDERSTATLOADER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QSet>
+#include <QStringList>
+#include "folderentrytable.h"
+
+namespace Farman
+{
+
+// 行ごとの属性の取得(stat)をワーカースレッドで行い、結果をバッチ単位で通知する
+// 要求は優先する順に並べて渡し、新しい要求で置き換える(表示範囲が変わった場合など)
+class FolderStatLoader : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit FolderStatLoader(QObject *parent = Q_NULLPTR);
+    ~FolderStatLoader() Q_DECL_OVERRIDE;
+
+    // 同じ requestId で既に stat したエントリは、再び要求されても stat し直さない
+    void setRequests(int requestId, int statFields, const QVector<int>& entries, const QStringList& filePaths);
+    void clearRequests();
+    void stop();
+
+Q_SIGNALS:
+    void statLoaded(int requestId, const QVector<int>& entries, const FolderEntryTable& entryTable);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_waitCondition;
+    int m_requestId;
+    int m_statFields;
+    QVector<int> m_entries;
+    QStringList m_filePaths;
+    int m_nextRequest;          // 次に stat する m_entries のインデックス
+    QSet<int> m_takenEntries;   // m_requestId で stat に取り出したエントリ
+};
+
+}           // namespace Farman
+
+#endif // FOLDERSTATLOADER_H
@@ -0,0 +1,207 @@
+﻿#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <numeric>
+#include "foldertreescanner.h"
+#ifdef Q_OS_LINUX
+#include "linux.h"
+#endif
+
+namespace Farman
+{
+
+FolderTreeScanner::FolderTreeScanner(int scanId, const QDir& dir, QObject *parent/* = Q_NULLPTR*/)
+    : FolderScanner(scanId, dir, parent)
+    , m_maxDepth(-1)
+    , m_skipTypeFlags(0)
+    , m_chunkSize(256)
+{
+    setBatchSize(10000);
+}
+
+FolderTreeScanner::~FolderTreeScanner()
+{
+}
+
+void FolderTreeScanner::setMaxDepth(int maxDepth)
+{
+    m_maxDepth = maxDepth;
+}
+
+int FolderTreeScanner::maxDepth() const
+{
+    return m_maxDepth;
+}
+
+void FolderTreeScanner::setSkipTypeFlags(int typeFlags)
+{
+    m_skipTypeFlags = typeFlags;
+}
+
+int FolderTreeScanner::skipTypeFlags() const
+{
+    return m_skipTypeFlags;
+}
+
+bool FolderTreeScanner::matchEntry(const QString& folderPath, const FolderEntryTable& entryTable, int entry)
+{
+    Q_UNUSED(folderPath);
+    Q_UNUSED(entryTable);
+    Q_UNUSED(entry);
+
+    return true;
+}
+
+void FolderTreeScanner::chunkScanned(bool finished)
+{
+    Q_UNUSED(finished);
+}
+
+void FolderTreeScanner::run()
+{
+    struct PendingDir
+    {
+        QString relativePath;
+        int depth;
+        bool hidden;            // 隠しディレクトリ以下
+    };
+
+    // 末尾から取り出して深さ優先に近い順で辿り、未読のディレクトリが溜まり過ぎないようにする
+    QVector<PendingDir> pendingDirs = { {QString(), 0, false} };
+
+    FolderEntryTable batch;
+    int entryNum = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while(!pendingDirs.isEmpty())
+    {
+        if(isInterruptionRequested())
+        {
+            return;
+        }
+
+        int chunkNum = qMin(pendingDirs.count(), m_chunkSize);
+        QVector<PendingDir> chunk = pendingDirs.mid(pendingDirs.count() - chunkNum);
+        pendingDirs.resize(pendingDirs.count() - chunkNum);
+
+        QVector<FolderEntryTable> entryTables(chunkNum);
+        QVector<QVector<bool>> matchedLists(chunkNum);
+        QVector<int> indexes(chunkNum);
+        std::iota(indexes.begin(), indexes.end(), 0);
+        QtConcurrent::blockingMap(indexes, [&](int index)
+        {
+            if(isInterruptionRequested())
+            {
+                return;
+            }
+
+            QString path = folderPath(chunk[index].relativePath);
+            FolderEntryTable& entryTable = entryTables[index];
+            readFolder(path, entryTable);
+
+            // 内容の検索など重い判定も、読み込みと同じスレッドで済ませる
+            QVector<bool>& matchedList = matchedLists[index];
+            matchedList.resize(entryTable.count());
+            for(int entry = 0;entry < entryTable.count();entry++)
+            {
+                int typeFlags = entryTable.typeFlags(entry) | ((chunk[index].hidden) ? FolderEntryTable::Hidden : 0);
+
+                matchedList[entry] = !(typeFlags & (m_skipTypeFlags | FolderEntryTable::DotDot)) &&
+                                     matchEntry(path, entryTable, entry);
+            }
+        });
+
+        for(int index = 0;index < chunkNum;index++)
+        {
+            const PendingDir& dir = chunk[index];
+            const FolderEntryTable& entryTable = entryTables[index];
+            const QVector<bool>& matchedList = matchedLists[index];
+
+            QString prefix = (dir.relativePath.isEmpty()) ? QString() : dir.relativePath + '/';
+
+            batch.setStatFields(batch.statFields() & entryTable.statFields());
+
+            for(int entry = 0;entry < entryTable.count();entry++)
+            {
+                int typeFlags = entryTable.typeFlags(entry);
+                if(dir.hidden)
+                {
+                    typeFlags |= FolderEntryTable::Hidden;
+                }
+
+                if(typeFlags & (m_skipTypeFlags | FolderEntryTable::DotDot))
+                {
+                    continue;
+                }
+
+                QString relativePath = prefix + entryTable.fileName(entry);
+
+                if(matchedList[entry])
+                {
+                    batch.append(relativePath,
+                                 typeFlags,
+                                 entryTable.size(entry),
+                                 entryTable.lastModified(entry),
+                                 entryTable.created(entry),
+                                 entryTable.permissions(entry),
+                                 entryTable.ownerId(entry),
+                                 entryTable.groupId(entry));
+                    entryNum++;
+                }
+
+                // シンボリックリンクのディレクトリは循環し得るので辿らない
+                if((typeFlags & FolderEntryTable::Dir) && !(typeFlags & FolderEntryTable::SymLink) &&
+                   (m_maxDepth < 0 || dir.depth < m_maxDepth))
+                {
+                    pendingDirs.push_back({relativePath, dir.depth + 1, (typeFlags & FolderEntryTable::Hidden) != 0});
+                }
+            }
+        }
+
+        if(batch.count() >= batchSize() || (!batch.isEmpty() && timer.elapsed() >= batchInterval()))
+        {
+            emit entriesFound(scanId(), batch);
+
+            batch.clear();
+            timer.restart();
+        }
+
+        chunkScanned(false);
+    }
+
+    if(isInterruptionRequested())
+    {
+        return;
+    }
+
+    chunkScanned(true);
+
+    if(!batch.isEmpty())
+    {
+        emit entriesFound(scanId(), batch);
+    }
+
+    emit scanFinished(scanId(), (entryNum > 0) ? 0 : -1);
+}
+
+QString FolderTreeScanner::folderPath(const QString& relativePath) const
+{
+    return (relativePath.isEmpty()) ? dir().path() : dir().filePath(relativePath);
+}
+
+void FolderTreeScanner::readFolder(const QString& path, FolderEntryTable& entryTable) const
+{
+#ifdef Q_OS_LINUX
+    if(Linux::readFolderEntries(path, statFields(), entryTable) == 0)
+    {
+        return;
+    }
+#endif
+
+    // 読めないディレクトリは空として扱う
+    entryTable.clear();
+    entryTable.append(QDir(path).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System));
+}
+
+}           // namespace Farman
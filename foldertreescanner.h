@@ -0,0 +1,43 @@
+﻿#ifndef FOLDERTREESCANNER_H
+#define FOLDERTREESCANNER_H
+
+#include "folderscanner.h"
+
+namespace Farman
+{
+
+// サブディレクトリ以下も含めて列挙する(エントリ名はルートからの相対パス)
+// 同じ深さのディレクトリは並列に読み、結果は FolderScanner と同じくバッチ単位で通知する
+class FolderTreeScanner : public FolderScanner
+{
+    Q_OBJECT
+
+public:
+    explicit FolderTreeScanner(int scanId, const QDir& dir, QObject *parent = Q_NULLPTR);
+    ~FolderTreeScanner() Q_DECL_OVERRIDE;
+
+    void setMaxDepth(int maxDepth);         // 辿るサブディレクトリの深さ(0 = ルートのみ、-1 = 無制限)
+    int maxDepth() const;
+    void setSkipTypeFlags(int typeFlags);   // 指定した FolderEntryTable::TypeFlag を持つエントリは一覧にも含めず、辿りもしない
+    int skipTypeFlags() const;
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+    // 一覧に含めるエントリか(ディレクトリの読み込みと同じく複数のスレッドから呼ばれる)
+    virtual bool matchEntry(const QString& folderPath, const FolderEntryTable& entryTable, int entry);
+    // 並列に読んだディレクトリの結果をまとめる度に呼ばれる(finished = true は最後の 1 回)
+    virtual void chunkScanned(bool finished);
+
+private:
+    QString folderPath(const QString& relativePath) const;
+    void readFolder(const QString& path, FolderEntryTable& entryTable) const;
+
+    int m_maxDepth;
+    int m_skipTypeFlags;
+    int m_chunkSize;            // 1 度に並列に読むディレクトリ数
+};
+
+}           // namespace Farman
+
+#endif // FOLDERTREESCANNER_H
@@ -0,0 +1,371 @@
+﻿#include <QFile>
+#include <QVector>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "linux.h"
+
+namespace Farman
+{
+
+namespace Linux
+{
+
+namespace
+{
+
+struct LinuxDirent64
+{
+    quint64        d_ino;
+    qint64         d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[1];
+};
+
+// getdents64 1 回で読み込むサイズ(エントリ数千件分)
+const int DirentBufferSize = 256 * 1024;
+
+struct EntryStat
+{
+    unsigned int mode;
+    qint64 size;
+    qint64 lastModified;
+    qint64 created;
+    uint ownerId;
+    uint groupId;
+};
+
+// QDir・QFileInfo で読んだテーブルと差分を取れるように、QDateTime と同じくミリ秒に切り捨てる
+qint64 timeToNsecs(qint64 sec, qint64 nsec)
+{
+    return sec * 1000000000 + nsec / 1000000 * 1000000;
+}
+
+bool statEntry(int dirFd, const char* name, bool followLink, int statFields, EntryStat* entryStat)
+{
+#ifdef STATX_TYPE
+    unsigned int mask = STATX_TYPE;
+    if(statFields & FolderEntryTable::SizeField)
+    {
+        mask |= STATX_SIZE;
+    }
+    if(statFields & FolderEntryTable::TimeField)
+    {
+        mask |= STATX_MTIME | STATX_BTIME;
+    }
+    if(statFields & (FolderEntryTable::OwnerField | FolderEntryTable::ModeField))
+    {
+        mask |= STATX_UID | STATX_GID;
+    }
+    if(statFields & FolderEntryTable::ModeField)
+    {
+        mask |= STATX_MODE;
+    }
+
+    struct statx stx;
+    int flags = AT_STATX_DONT_SYNC | ((followLink) ? 0 : AT_SYMLINK_NOFOLLOW);
+    if(::statx(dirFd, name, flags, mask, &stx) != 0)
+    {
+        return false;
+    }
+
+    entryStat->mode = stx.stx_mode;
+    entryStat->size = static_cast<qint64>(stx.stx_size);
+    entryStat->lastModified = timeToNsecs(stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec);
+    entryStat->created = (stx.stx_mask & STATX_BTIME) ? timeToNsecs(stx.stx_btime.tv_sec, stx.stx_btime.tv_nsec) : 0;
+    entryStat->ownerId = stx.stx_uid;
+    entryStat->groupId = stx.stx_gid;
+#else
+    Q_UNUSED(statFields);
+
+    struct stat st;
+    if(::fstatat(dirFd, name, &st, (followLink) ? 0 : AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        return false;
+    }
+
+    entryStat->mode = st.st_mode;
+    entryStat->size = static_cast<qint64>(st.st_size);
+    entryStat->lastModified = timeToNsecs(st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+    entryStat->created = 0;
+    entryStat->ownerId = st.st_uid;
+    entryStat->groupId = st.st_gid;
+#endif
+
+    return true;
+}
+
+bool isGroupMember(uint groupId)
+{
+    static const QVector<gid_t> groups = []()
+    {
+        QVector<gid_t> groups(::getgroups(0, Q_NULLPTR));
+        groups.resize(qMax(::getgroups(groups.count(), groups.data()), 0));
+        groups.push_back(::getegid());
+
+        return groups;
+    }();
+
+    return groups.contains(static_cast<gid_t>(groupId));
+}
+
+// ReadUser などは実効ユーザーから見た権限にする(QFileInfo と同様)
+QFile::Permissions toPermissions(unsigned int mode, uint ownerId, uint groupId)
+{
+    static const uint euid = ::geteuid();
+
+    int permissions = 0;
+    permissions |= (mode & S_IRUSR) ? QFile::ReadOwner  : 0;
+    permissions |= (mode & S_IWUSR) ? QFile::WriteOwner : 0;
+    permissions |= (mode & S_IXUSR) ? QFile::ExeOwner   : 0;
+    permissions |= (mode & S_IRGRP) ? QFile::ReadGroup  : 0;
+    permissions |= (mode & S_IWGRP) ? QFile::WriteGroup : 0;
+    permissions |= (mode & S_IXGRP) ? QFile::ExeGroup   : 0;
+    permissions |= (mode & S_IROTH) ? QFile::ReadOther  : 0;
+    permissions |= (mode & S_IWOTH) ? QFile::WriteOther : 0;
+    permissions |= (mode & S_IXOTH) ? QFile::ExeOther   : 0;
+
+    unsigned int userMode = 0;
+    if(euid == 0)
+    {
+        userMode = S_IROTH | S_IWOTH | ((mode & (S_IXUSR | S_IXGRP | S_IXOTH)) ? S_IXOTH : 0);
+    }
+    else if(ownerId == euid)
+    {
+        userMode = (mode >> 6) & 7;
+    }
+    else if(isGroupMember(groupId))
+    {
+        userMode = (mode >> 3) & 7;
+    }
+    else
+    {
+        userMode = mode & 7;
+    }
+
+    permissions |= (userMode & S_IROTH) ? QFile::ReadUser  : 0;
+    permissions |= (userMode & S_IWOTH) ? QFile::WriteUser : 0;
+    permissions |= (userMode & S_IXOTH) ? QFile::ExeUser   : 0;
+
+    return QFile::Permissions(permissions);
+}
+
+void appendEntry(int dirFd, const char* name, unsigned char type, int statFields, FolderEntryTable& entryTable)
+{
+    bool dotDot = (qstrcmp(name, "..") == 0);
+
+    int typeFlags = 0;
+    if(dotDot)
+    {
+        typeFlags |= FolderEntryTable::DotDot;
+    }
+    else if(name[0] == '.')
+    {
+        typeFlags |= FolderEntryTable::Hidden;
+    }
+
+    EntryStat entryStat = {0, 0, 0, 0, static_cast<uint>(-2), static_cast<uint>(-2)};
+    bool stated = false;
+
+    // シンボリックリンクはリンク先の属性を使う(QFileInfo と同様)
+    if(type == DT_UNKNOWN)
+    {
+        stated = statEntry(dirFd, name, false, statFields, &entryStat);
+        if(stated && S_ISLNK(entryStat.mode))
+        {
+            type = DT_LNK;
+        }
+    }
+
+    if(type == DT_LNK)
+    {
+        typeFlags |= FolderEntryTable::SymLink;
+
+        // リンク切れの場合はリンク自身の属性のまま
+        EntryStat targetStat = entryStat;
+        if(statEntry(dirFd, name, true, statFields, &targetStat))
+        {
+            entryStat = targetStat;
+            stated = true;
+        }
+    }
+    else if(!stated && statFields != FolderEntryTable::NoStatField)
+    {
+        stated = statEntry(dirFd, name, false, statFields, &entryStat);
+    }
+
+    if(stated)
+    {
+        if(S_ISDIR(entryStat.mode))
+        {
+            typeFlags |= FolderEntryTable::Dir;
+        }
+        else if(S_ISREG(entryStat.mode))
+        {
+            typeFlags |= FolderEntryTable::File;
+        }
+    }
+    else if(type == DT_DIR)
+    {
+        typeFlags |= FolderEntryTable::Dir;
+    }
+    else if(type == DT_REG)
+    {
+        typeFlags |= FolderEntryTable::File;
+    }
+
+    QFile::Permissions permissions;
+    if(statFields & FolderEntryTable::ModeField)
+    {
+        permissions = toPermissions(entryStat.mode, entryStat.ownerId, entryStat.groupId);
+        if(permissions & QFile::WriteUser)
+        {
+            typeFlags |= FolderEntryTable::Writable;
+        }
+    }
+    else
+    {
+        // 権限を取得していない場合は書き込み可能として扱う
+        typeFlags |= FolderEntryTable::Writable;
+    }
+
+    entryTable.append(QFile::decodeName(name),
+                      typeFlags,
+                      (statFields & FolderEntryTable::SizeField) ? entryStat.size : 0,
+                      (statFields & FolderEntryTable::TimeField) ? entryStat.lastModified : 0,
+                      (statFields & FolderEntryTable::TimeField) ? entryStat.created : 0,
+                      permissions,
+                      (statFields & FolderEntryTable::OwnerField) ? entryStat.ownerId : static_cast<uint>(-2),
+                      (statFields & FolderEntryTable::OwnerField) ? entryStat.groupId : static_cast<uint>(-2));
+}
+
+}           // namespace
+
+int readFolderEntries(const QString& path, int statFields, FolderEntryTable& entryTable)
+{
+    FolderReader reader;
+    if(reader.open(path, statFields) < 0)
+    {
+        return -1;
+    }
+
+    FolderEntryTable newEntryTable;
+    newEntryTable.setStatFields(statFields);
+
+    int ret = 0;
+    while((ret = reader.read(std::numeric_limits<int>::max(), newEntryTable)) > 0)
+    {
+    }
+
+    if(ret < 0)
+    {
+        return -1;
+    }
+
+    entryTable = newEntryTable;
+
+    return 0;
+}
+
+void appendFileEntry(const QString& filePath, int statFields, FolderEntryTable& entryTable)
+{
+    // 種別は分からないので、リンクでなければ 1 回の stat で済む
+    appendEntry(AT_FDCWD, QFile::encodeName(filePath).constData(), DT_UNKNOWN, statFields, entryTable);
+}
+
+FolderReader::FolderReader()
+    : m_dirFd(-1)
+    , m_statFields(FolderEntryTable::AllStatFields)
+    , m_buffer()
+    , m_readSize(0)
+    , m_offset(0)
+{
+}
+
+FolderReader::~FolderReader()
+{
+    close();
+}
+
+int FolderReader::open(const QString& path, int statFields)
+{
+    close();
+
+    m_dirFd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(m_dirFd < 0)
+    {
+        return -1;
+    }
+
+    m_statFields = statFields;
+    if(m_buffer.isEmpty())
+    {
+        m_buffer = QByteArray(DirentBufferSize, Qt::Uninitialized);
+    }
+
+    return 0;
+}
+
+void FolderReader::close()
+{
+    if(m_dirFd >= 0)
+    {
+        ::close(m_dirFd);
+        m_dirFd = -1;
+    }
+
+    m_readSize = 0;
+    m_offset = 0;
+}
+
+int FolderReader::read(int maxCount, FolderEntryTable& entryTable)
+{
+    if(m_dirFd < 0)
+    {
+        return -1;
+    }
+
+    // 取得していない属性は、追加後も取得していない扱いにする
+    entryTable.setStatFields((entryTable.isEmpty()) ? m_statFields : entryTable.statFields() & m_statFields);
+
+    int readNum = 0;
+    while(readNum < maxCount)
+    {
+        if(m_offset >= m_readSize)
+        {
+            m_readSize = ::syscall(SYS_getdents64, m_dirFd, m_buffer.data(), m_buffer.size());
+            m_offset = 0;
+            if(m_readSize < 0)
+            {
+                m_readSize = 0;
+
+                return -1;
+            }
+            if(m_readSize == 0)
+            {
+                break;
+            }
+        }
+
+        const LinuxDirent64* dirent = reinterpret_cast<const LinuxDirent64*>(m_buffer.constData() + m_offset);
+        m_offset += dirent->d_reclen;
+
+        if(qstrcmp(dirent->d_name, ".") == 0)
+        {
+            continue;
+        }
+
+        appendEntry(m_dirFd, dirent->d_name, dirent->d_type, m_statFields, entryTable);
+        readNum++;
+    }
+
+    return readNum;
+}
+
+}           // namespace Linux
+
+}           // namespace Farman
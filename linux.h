@@ -0,0 +1,48 @@
+﻿#ifndef LINUX_H
+#define LINUX_H
+
+#include <QString>
+#include <QByteArray>
+#include "folderentrytable.h"
+
+namespace Farman
+{
+
+namespace Linux
+{
+
+// getdents64 / statx でディレクトリを列挙する
+// statFields で指定した属性のみ stat し、d_type で種別が分かるエントリは stat を省略する
+// 戻り値 : 0 = 成功, -1 = 失敗(呼び出し元で QDir にフォールバックする)
+int readFolderEntries(const QString& path, int statFields, FolderEntryTable& entryTable);
+
+// filePath 1 件の属性を statFields の分だけ stat して entryTable に追加する(表示する行の属性を後から取得する場合に使う)
+void appendFileEntry(const QString& filePath, int statFields, FolderEntryTable& entryTable);
+
+// readFolderEntries を少しずつ読み進める版(ワーカースレッドで一覧をバッチ単位に通知する場合に使う)
+class FolderReader
+{
+public:
+    FolderReader();
+    ~FolderReader();
+
+    int open(const QString& path, int statFields);          // 0 = 成功, -1 = 失敗
+    void close();
+
+    // 最大 maxCount 件を entryTable に追加する
+    // 戻り値 : 追加したエントリ数(0 = 終端), -1 = 失敗
+    int read(int maxCount, FolderEntryTable& entryTable);
+
+private:
+    int m_dirFd;
+    int m_statFields;
+    QByteArray m_buffer;
+    long m_readSize;            // m_buffer に読み込んだサイズ
+    long m_offset;              // m_buffer の未処理の位置
+};
+
+}           // namespace Linux
+
+}           // namespace Farman
+
+#endif // LINUX_H